@@ -0,0 +1,129 @@
+#ifndef YADISK_ASYNC_CLIENT_HPP
+#define YADISK_ASYNC_CLIENT_HPP
+
+#include <functional>
+#include <memory>
+
+#include <boost/version.hpp>
+#if BOOST_VERSION < 106600
+#error "AsyncClient needs Boost 1.66 or newer, see the BUILD_ASYNC_CLIENT option"
+#endif
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    ///
+    /// \brief category of transport errors reported by curl, the value of
+    ///     error_code is CURLcode.
+    ///
+    auto curl_category() -> const boost::system::error_category&;
+
+    ///
+    /// \brief AsyncClient performs requests of a Client on an external
+    ///     io_context: sockets are watched by asio and transfers are driven by
+    ///     curl_multi_socket_action, so no extra threads are spawned.
+    ///     Completion tokens are asio ones: a handler, yield_context or
+    ///     use_future.
+    ///
+    /// Handlers are invoked from the io_context. Several threads may run the
+    /// io_context, all internal state is serialized by a strand. It is built
+    /// with the BUILD_ASYNC_CLIENT option only.
+    ///
+    class AsyncClient
+    {
+    public:
+
+        using json_handler_t = std::function<void(boost::system::error_code, json)>;
+
+        using bool_handler_t = std::function<void(boost::system::error_code, bool)>;
+
+        AsyncClient(boost::asio::io_context& io, Client client);
+
+        AsyncClient(const AsyncClient&) = delete;
+
+        auto operator=(const AsyncClient&) -> AsyncClient& = delete;
+
+        ///
+        /// \brief aborts all requests in flight, their handlers are called
+        ///     with boost::asio::error::operation_aborted.
+        ///
+        ~AsyncClient();
+
+        template <class CompletionToken>
+        auto async_ping(CompletionToken&& token)
+            -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, bool)) {
+            boost::asio::async_completion<CompletionToken, void(boost::system::error_code, bool)> init(token);
+            start_ping(bind_handler<bool>(init.completion_handler));
+            return init.result.get();
+        }
+
+        ///
+        /// \brief asynchronous version of Client::info, an error json from
+        ///     the api is passed to handler as the result, not as an error.
+        ///
+        template <class CompletionToken>
+        auto async_info(url::path resource, json options, CompletionToken&& token)
+            -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, json)) {
+            boost::asio::async_completion<CompletionToken, void(boost::system::error_code, json)> init(token);
+            start_info(resource, options, bind_handler<json>(init.completion_handler));
+            return init.result.get();
+        }
+
+        template <class CompletionToken>
+        auto async_copy(url::path from, url::path to, bool overwrite, std::list<string> fields, CompletionToken&& token)
+            -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, json)) {
+            boost::asio::async_completion<CompletionToken, void(boost::system::error_code, json)> init(token);
+            start_copy(from, to, overwrite, fields, bind_handler<json>(init.completion_handler));
+            return init.result.get();
+        }
+
+        template <class CompletionToken>
+        auto async_patch(url::path resource, json meta, std::list<string> fields, CompletionToken&& token)
+            -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, json)) {
+            boost::asio::async_completion<CompletionToken, void(boost::system::error_code, json)> init(token);
+            start_patch(resource, meta, fields, bind_handler<json>(init.completion_handler));
+            return init.result.get();
+        }
+
+        auto client() -> Client& {
+            return m_client;
+        }
+
+    private:
+
+        class impl;
+
+        ///
+        /// \brief erases type of completion handler, keeping its associated
+        ///     executor (e.g. strand of a coroutine) to invoke it on.
+        ///
+        template <class Result, class Handler>
+        auto bind_handler(Handler& handler) -> std::function<void(boost::system::error_code, Result)> {
+            auto executor = boost::asio::get_associated_executor(handler, m_io.get_executor());
+            return [executor, handler](boost::system::error_code ec, Result result) {
+                boost::asio::dispatch(executor, std::bind(handler, ec, result));
+            };
+        }
+
+        auto start_ping(bool_handler_t handler) -> void;
+
+        auto start_info(url::path resource, json options, json_handler_t handler) -> void;
+
+        auto start_copy(url::path from, url::path to, bool overwrite, std::list<string> fields, json_handler_t handler) -> void;
+
+        auto start_patch(url::path resource, json meta, std::list<string> fields, json_handler_t handler) -> void;
+
+        boost::asio::io_context& m_io;
+        Client m_client;
+        std::shared_ptr<impl> m_impl;
+    };
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef YADISK_BLOB_CACHE_HPP
+#define YADISK_BLOB_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    ///
+    /// \brief local cache of downloaded files addressed by their sha256,
+    ///     shared by any number of downloads of the same content.
+    ///
+    /// A file already in the cache is not transferred, it is cloned from
+    /// the cache (reflink where the file system supports it), hard linked
+    /// or copied. Cached files are read only: a hard linked download shares
+    /// the file with the cache and must not be modified in place.
+    ///
+    /// The cache is kept under capacity bytes by evicting files used least
+    /// recently. Several processes may share a cache directory.
+    ///
+    class BlobCache
+    {
+    public:
+
+        BlobCache(fs::path directory, std::uint64_t capacity);
+
+        ///
+        /// \brief path of the cached file with content sha256, empty if it
+        ///     is not cached.
+        ///
+        auto find(const string& sha256) const -> fs::path;
+
+        ///
+        /// \brief downloads file from to local path to through the cache:
+        ///     the sha256 is looked up with info, a hit is linked from the
+        ///     cache, a miss is downloaded into the cache, verified and then
+        ///     linked.
+        /// \return meta information of the file, json with error message
+        ///     if the api refused, empty json() on other errors, e.g. when
+        ///     the content does not match its sha256
+        ///
+        auto download(Client& client, url::path from, fs::path to) -> json;
+
+        ///
+        /// \brief total size of cached files.
+        ///
+        auto size() const -> std::uint64_t;
+
+        ///
+        /// \brief removes least recently used files until the cache fits
+        ///     into its capacity.
+        ///
+        auto evict() -> void;
+
+    private:
+
+        auto blob_path(const string& sha256) const -> fs::path;
+
+        ///
+        /// \brief evicts as evict() does, but never the blob keep.
+        ///
+        auto evict(const fs::path& keep) -> void;
+
+        fs::path m_directory;
+        std::uint64_t m_capacity;
+    };
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef YADISK_CANCELLATION_HPP
+#define YADISK_CANCELLATION_HPP
+
+#include <atomic>
+#include <memory>
+
+namespace yadisk
+{
+    ///
+    /// \brief cancels requests of the clients it is given to. Copies share
+    ///     one state, so a copy kept by the caller cancels requests made
+    ///     with another copy on a different thread.
+    ///
+    class cancellation
+    {
+    public:
+
+        cancellation() : m_cancelled{std::make_shared<std::atomic<bool>>(false)} {}
+
+        ///
+        /// \brief aborts requests in flight and fails the ones not started,
+        ///     with CURLE_ABORTED_BY_CALLBACK. It can not be undone.
+        ///
+        auto cancel() -> void {
+            m_cancelled->store(true);
+        }
+
+        auto cancelled() const -> bool {
+            return m_cancelled->load();
+        }
+
+        auto state() const -> std::shared_ptr<const std::atomic<bool>> {
+            return m_cancelled;
+        }
+
+    private:
+
+        std::shared_ptr<std::atomic<bool>> m_cancelled;
+    };
+}
+
+#endif
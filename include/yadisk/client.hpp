@@ -4,23 +4,206 @@ using json = nlohmann::json;
 #include <string>
 using std::string;
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstdint>
 
 #include <boost/filesystem.hpp>
 namespace fs = boost::filesystem;
 
 #include "url/path.hpp"
+#include "yadisk/cancellation.hpp"
+#include "yadisk/document.hpp"
+#include "yadisk/priority.hpp"
+#include "yadisk/result.hpp"
+#include "yadisk/sink.hpp"
+#include "yadisk/source.hpp"
 
 namespace yadisk
 {
+    namespace detail
+    {
+        class context;
+        class request;
+        struct tenant;
+    }
+
+    class AsyncClient;
+    class PreviewCache;
+    class ClientPool;
+    class RemoteFile;
+
+    ///
+    /// \brief initializes libcurl. The first Client does it otherwise;
+    ///     call it from main before starting threads if clients are created
+    ///     concurrently, or to fail early.
+    /// \return false if libcurl cannot be initialized
+    ///
+    auto initialize() -> bool;
+
+    ///
+    /// \brief Client is safe to share between threads: the only mutable state
+    ///     is the token, which is swapped atomically, easy handles and their
+    ///     connections are cached per thread and dns and tls sessions are
+    ///     shared by all copies of the client.
+    ///
     class Client
     {
     public:
 
         Client(string token);
 
+        ///
+        /// \brief returns the token used by requests started from now on.
+        ///
+        auto token() const -> string;
+
+        ///
+        /// \brief replaces the token, e.g. on rotation; requests already
+        ///     in flight keep the previous one.
+        ///
+        auto set_token(string token) -> void;
+
+        struct stats_t
+        {
+            std::uint64_t requests;
+            std::uint64_t failures;
+            std::uint64_t bytes_sent;
+            std::uint64_t bytes_received;
+            /// identical requests answered by a request already in flight
+            std::uint64_t coalesced;
+            /// requests sent once more because the first copy was slow
+            std::uint64_t hedged;
+        };
+
+        ///
+        /// \brief returns counters accumulated by this client and its copies.
+        ///
+        auto stats() const -> stats_t;
+
+        struct limits_t
+        {
+            /// transfers of the class running at a time, 0 is unlimited
+            std::size_t connections;
+            /// bytes per second, 0 is unlimited
+            std::uint64_t send_rate;
+            std::uint64_t receive_rate;
+        };
+
+        ///
+        /// \brief sets the connection budget and bandwidth caps of a priority
+        ///     class, for this client and all its copies.
+        ///
+        auto set_limits(priority level, limits_t limits) -> void;
+
+        ///
+        /// \brief caps bandwidth of all classes together, bytes per second,
+        ///     0 is unlimited. Interactive transfers are counted, but never
+        ///     wait for the global cap.
+        ///
+        auto set_bandwidth(std::uint64_t send_rate, std::uint64_t receive_rate) -> void;
+
+        ///
+        /// \brief sets the class of requests made by this copy of the client,
+        ///     e.g. a copy running backups is background. Downloads and
+        ///     uploads are never above bulk. Set it before the copy is shared
+        ///     between threads.
+        ///
+        auto set_priority(priority level) -> void;
+
+        auto get_priority() const -> priority;
+
+        ///
+        /// \brief requests made by this copy of the client fail with
+        ///     CURLE_OPERATION_TIMEDOUT past deadline, the ones in flight too.
+        ///     Give a call a deadline of its own on a copy of the client:
+        ///     every request the call makes shares it. Requests with a
+        ///     deadline or a cancellation are never coalesced with identical
+        ///     requests of other callers.
+        ///
+        auto set_deadline(std::chrono::steady_clock::time_point deadline) -> void;
+
+        ///
+        /// \brief limits each request made by this copy to timeout, within
+        ///     the deadline if one is set. 0 is no limit.
+        ///
+        auto set_timeout(std::chrono::milliseconds timeout) -> void;
+
+        ///
+        /// \brief requests made by this copy are aborted with
+        ///     CURLE_ABORTED_BY_CALLBACK once token is cancelled; a transfer
+        ///     waiting for the server notices it within about a second.
+        ///
+        auto set_cancellation(cancellation token) -> void;
+
+        ///
+        /// \brief a transfer which moves no data for timeout is aborted with
+        ///     CURLE_OPERATION_TIMEDOUT, 60 seconds by default, 0 waits
+        ///     forever.
+        ///
+        auto set_stall_timeout(std::chrono::seconds timeout) -> void;
+
+        ///
+        /// \brief lets GET calls of this copy, e.g. info and list, send a
+        ///     duplicate of a request which got no answer within percentile
+        ///     of the latencies of recent hedged calls; the first answer is
+        ///     taken and the other transfer dropped. At most budget of the
+        ///     calls are sent twice. Percentile 0 turns hedging off.
+        ///
+        auto set_hedging(double percentile, double budget = 0.05) -> void;
+
+        ///
+        /// \brief appends every http exchange of this client and its copies
+        ///     to transcript, with the Authorization header redacted.
+        ///     Bodies of downloads and uploads are kept as sizes only.
+        /// \return false if transcript cannot be written
+        ///
+        auto record(fs::path transcript) -> bool;
+
+        auto stop_recording() -> void;
+
+        ///
+        /// \brief answers requests from transcript instead of the network,
+        ///     each after its recorded duration multiplied by time_scale.
+        ///     Requests are matched by method and url, a request missing from
+        ///     the transcript fails to connect. Downloads receive zeros of the
+        ///     recorded size.
+        /// \return false if transcript cannot be read, nothing changes then
+        ///
+        auto replay(fs::path transcript, double time_scale = 1.0) -> bool;
+
+        auto stop_replaying() -> void;
+
         auto ping() -> bool;
 
+        ///
+        /// \brief resolves the api host and opens up to connections
+        ///     connections at once on a background thread, so the first
+        ///     requests of every thread skip the dns lookup and resume the tls
+        ///     session instead of a full handshake. Connections are cached per
+        ///     thread, so the ones opened here are not reused. Wait for the
+        ///     result before the process exits.
+        /// \return number of connections established
+        ///
+        auto warmup(std::size_t connections = 2) -> std::future<std::size_t>;
+
+        ///
+        /// \brief sends a header only request every interval, which keeps
+        ///     the dns entry and the tls session fresh and checks the api is
+        ///     reachable. A zero interval stops it.
+        ///
+        auto keep_alive(std::chrono::seconds interval) -> void;
+
+        ///
+        /// \brief whether the last keep alive request succeeded.
+        ///
+        auto healthy() const -> bool;
+
         auto info() -> json;
 
         ///
@@ -37,20 +220,160 @@ namespace yadisk
         ///
         auto info(url::path resource, json options = nullptr) -> json;
 
+        ///
+        /// \brief options of info compiled into a url template, for many
+        ///     calls with the same options and different paths.
+        ///
+        class prepared_info
+        {
+        private:
+            friend class Client;
+
+            string m_prefix;
+        };
+
+        ///
+        /// \brief compiles options of info once, see info above.
+        ///
+        auto prepare_info(json options = nullptr) const -> prepared_info;
+
+        ///
+        /// \brief info with prepared options, only resource is escaped and
+        ///     appended to the url per call.
+        ///
+        auto info(const prepared_info& prepared, url::path resource) -> json;
+
+        ///
+        /// \brief flat list of all files, one page of it, full information:
+        ///     https://tech.yandex.ru/disk/api/reference/all-files-docpage/
+        /// \param options is json with limit, offset, sort, media_type,
+        ///     fields, preview_size, preview_crop params
+        ///
         auto list(json options = nullptr) -> json;
 
+        ///
+        /// \brief streams the flat list of files from options["offset"] to
+        ///     the end. After the first page up to parallelism pages of
+        ///     options["limit"] (1000 by default) items are fetched at once,
+        ///     items are passed to visit in order. Pages are fetched at most
+        ///     twice parallelism ahead of the ones passed to visit.
+        /// \param visit returns false to stop listing
+        /// \return false if some page failed
+        ///
+        auto list(json options, std::function<bool(const json& item)> visit, std::size_t parallelism = 8) -> bool;
+
+        ///
+        /// \brief lists root and its subdirectories page by page, with up to
+        ///     parallelism listings in flight.
+        /// \param visit is called for every item (meta information as in
+        ///     info); it returns whether to descend into a directory item.
+        ///     Calls are made from the calling thread.
+        /// \return false if some listing failed
+        ///
+        auto walk(url::path root, std::function<bool(const json& item)> visit, std::size_t parallelism = 8) -> bool;
+
+        ///
+        /// \brief files sorted by upload date, newest first.
+        /// \param options is json with limit, media_type, fields,
+        ///     preview_size, preview_crop params
+        ///
+        auto last_uploaded(json options = nullptr) -> json;
+
+        ///
+        /// \brief uploads a file, the link for uploading is requested first.
+        /// \return json with the upload link on success, json with error
+        ///     message if the api refused, empty json() on transport errors.
+        ///
         auto upload(url::path to, fs::path from, bool overwrite, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief uploads content of source, chunked if its size is unknown.
+        ///     The source is read on the thread of the caller.
+        ///
+        auto upload(url::path to, source& from, bool overwrite, std::list<string> fields = std::list<string>()) -> json;
+
+        ///
+        /// \brief uploads content of stream while it is being read: the
+        ///     stream is read on its own thread into a ring buffer of
+        ///     buffer_size bytes, which is sent with chunked encoding.
+        ///
+        auto upload(url::path to, std::istream& from, bool overwrite, std::list<string> fields = std::list<string>(),
+                    std::size_t buffer_size = 4 << 20) -> json;
+
+        ///
+        /// \brief as the stream version, but content is pulled from producer,
+        ///     see callback_source.
+        ///
+        auto upload(url::path to, callback_source::callback_t producer, bool overwrite, std::list<string> fields = std::list<string>(),
+                    std::size_t buffer_size = 4 << 20) -> json;
+
         auto upload(url::path to, string url, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief uploads many local files, meant for small ones: links for
+        ///     the next files are requested while earlier files are being
+        ///     sent, so a file costs about one round trip instead of two.
+        ///     A file whose link expired before it was sent gets a new link.
+        /// \param files are pairs of a local file and its path on disk
+        /// \param lookahead bounds files with a link requested or a transfer
+        ///     started and not finished, and so open files
+        /// \return json with the number of files "uploaded" and a list of
+        ///     disk paths which "failed", empty json() on errors
+        ///
+        auto upload(std::vector<std::pair<fs::path, url::path>> files, bool overwrite,
+                    std::size_t parallelism = 8, std::size_t lookahead = 32) -> json;
+
         auto download(url::path from, url::path to, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief downloads a file into sink, see yadisk/sink.hpp for sinks
+        ///     writing into a buffer, a mapped file or a pipe.
+        /// \param from is a path to the file on disk
+        /// \param to receives content of the file
+        /// \return json with the download link on success, json with error
+        ///     message if the api refused, empty json() on transport errors.
+        ///
+        auto download(url::path from, sink& to) -> json;
+
         auto copy(url::path from, url::path to, bool overwrite, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief moves a file or a directory, directories known to exist
+        ///     by mkdir below from and to are forgotten.
+        ///
         auto move(url::path from, url::path to, bool overwrite, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief creates directory dir, its parent has to exist.
+        /// \return json with the link to the directory on success, json with
+        ///     error message if the api refused, e.g. the directory exists,
+        ///     empty json() on transport errors.
+        ///
         auto mkdir(url::path dir, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief makes sure directories exist, creating missing parents
+        ///     first. Shared parents are created once, and directories known
+        ///     to exist from earlier calls of any copy are not asked for
+        ///     again. Directories whose parent exists are created
+        ///     concurrently, a child as soon as its parent is there. remove
+        ///     and move of any copy forget the directories they touch; a
+        ///     directory changed by other means is found by the next call
+        ///     creating something inside it.
+        /// \return json with the number of directories "created", the number
+        ///     found existing by the api "existed", the number of dirs known
+        ///     to exist without a request "known" and a list of paths of dirs
+        ///     which "failed", empty json() on errors
+        ///
+        auto mkdir(std::vector<url::path> dirs, std::size_t parallelism = 8) -> json;
+
+        ///
+        /// \brief removes a file or a directory, into the trash unless
+        ///     permanently; directories known to exist by mkdir below
+        ///     resource are forgotten.
+        /// \return json with the link to the operation if the api removes
+        ///     it asynchronously, null json on immediate success
+        ///
         auto remove(url::path resource, bool permanently, std::list<string> fields = std::list<string>()) -> json;
 
         auto publish(url::path resource) -> json;
@@ -59,16 +382,131 @@ namespace yadisk
 
         auto patch(url::path resource, json meta, std::list<string> fields = std::list<string>()) -> json;
 
+        ///
+        /// \brief info about a public resource, see info above for options
+        ///     (except deleted).
+        /// \param public_key is a key or a public link of the resource
+        /// \param resource is a path inside a public folder
+        ///
         auto info(string public_key, url::path resource = nullptr, json options = nullptr) -> json;
-      
+
+        ///
+        /// \brief downloads a public file, or a file inside a public folder,
+        ///     into local file to.
+        ///
         auto download(string public_key, fs::path to, url::path file = nullptr)-> json;
-      
+
+        ///
+        /// \brief saves a public resource into Downloads folder of the disk.
+        ///
         auto save(string public_key, string name, url::path file = nullptr)-> json;
-        
-        string token;
+
+        ///
+        /// \brief downloads every file of a public folder into local directory
+        ///     to, keeping the tree. Listings and files are fetched
+        ///     concurrently, up to parallelism transfers at a time over shared
+        ///     connections. A file which failed is not left behind.
+        /// \param lookahead bounds files with a transfer queued or started
+        ///     and not finished, and so open files
+        /// \return json with count of downloaded files and an array of
+        ///     resources which failed, empty json() on transport errors.
+        ///
+        auto download_folder(string public_key, fs::path to, url::path folder = "/",
+                             std::size_t parallelism = 8, std::size_t lookahead = 32) -> json;
+
+        ///
+        /// \brief non throwing variants of the methods above, the json
+        ///     returning methods are built on them. A failure carries its
+        ///     kind, the http status and the name of the api error, e.g.
+        ///     errc::api, 404 and "DiskNotFoundError".
+        ///
+        auto try_info(url::path resource, json options = nullptr) -> result<json>;
+
+        auto try_info(const prepared_info& prepared, url::path resource) -> result<json>;
+
+        auto try_info(string public_key, url::path resource, json options) -> result<json>;
+
+        auto try_list(json options = nullptr) -> result<json>;
+
+        auto try_last_uploaded(json options = nullptr) -> result<json>;
+
+        auto try_copy(url::path from, url::path to, bool overwrite, std::list<string> fields = std::list<string>()) -> result<json>;
+
+        auto try_patch(url::path resource, json meta, std::list<string> fields = std::list<string>()) -> result<json>;
+
+        auto try_mkdir(url::path dir, std::list<string> fields = std::list<string>()) -> result<json>;
+
+        auto try_move(url::path from, url::path to, bool overwrite, std::list<string> fields = std::list<string>()) -> result<json>;
+
+        auto try_remove(url::path resource, bool permanently, std::list<string> fields = std::list<string>()) -> result<json>;
+
+        ///
+        /// \brief link to download a file, with "href" valid for a limited
+        ///     time; the storage it points to accepts range requests.
+        ///
+        auto try_download_link(url::path from) -> result<json>;
+
+        auto try_download(url::path from, sink& to) -> result<json>;
+
+        ///
+        /// \brief try_info and try_list parsed into a document, which
+        ///     allocates the response in a few blocks and frees it at once;
+        ///     meant for services reading many and large listings.
+        ///
+        auto try_info_document(url::path resource, json options = nullptr) -> result<document>;
+
+        auto try_list_document(json options = nullptr) -> result<document>;
+
+        auto try_upload(url::path to, source& from, bool overwrite, std::list<string> fields = std::list<string>()) -> result<json>;
 
     private:
-        auto info_impl (url::path resource, json options) -> json;
+        friend class AsyncClient;
+        friend class PreviewCache;
+        friend class ClientPool;
+        friend class RemoteFile;
+
+        auto ping_request() const -> std::unique_ptr<detail::request>;
+
+        auto info_request(url::path resource, json options) const -> std::unique_ptr<detail::request>;
+
+        auto copy_request(url::path from, url::path to, bool overwrite, std::list<string> fields) const -> std::unique_ptr<detail::request>;
+
+        auto patch_request(url::path resource, json meta, std::list<string> fields) const -> std::unique_ptr<detail::request>;
+
+        auto download_link_request(url::path from) const -> std::unique_ptr<detail::request>;
+
+        auto fetch_request(string href, sink& to) const -> std::unique_ptr<detail::request>;
+
+        auto upload_link_request(url::path to, bool overwrite, std::list<string> fields) const -> std::unique_ptr<detail::request>;
+
+        auto put_request(string href, source& from) const -> std::unique_ptr<detail::request>;
+
+        auto files_request(json options) const -> std::unique_ptr<detail::request>;
+
+        auto mkdir_request(url::path dir, std::list<string> fields) const -> std::unique_ptr<detail::request>;
+
+        ///
+        /// \brief drops dir and the directories below it from the ones known
+        ///     to exist.
+        ///
+        auto forget_directory(url::path dir) -> void;
+
+        auto public_info_request(string public_key, url::path resource, json options) const -> std::unique_ptr<detail::request>;
+
+        auto auth_header() const -> string;
+
+        auto new_request(string method) const -> std::unique_ptr<detail::request>;
+
+        std::shared_ptr<const string> m_token;
+        priority m_priority = priority::interactive;
+        std::shared_ptr<detail::tenant> m_tenant;
+        std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max();
+        std::chrono::milliseconds m_timeout{0};
+        std::shared_ptr<const std::atomic<bool>> m_cancelled;
+        std::chrono::seconds m_stall_timeout{60};
+        double m_hedge_percentile = 0;
+        double m_hedge_budget = 0;
+        std::shared_ptr<detail::context> m_context;
     };
 
 }
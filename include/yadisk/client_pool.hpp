@@ -0,0 +1,88 @@
+#ifndef YADISK_CLIENT_POOL_HPP
+#define YADISK_CLIENT_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    namespace detail
+    {
+        struct tenant;
+    }
+
+    ///
+    /// \brief clients of many accounts over one set of dns and tls caches.
+    ///     Requests of all accounts together are limited to a number of
+    ///     slots, divided between the accounts waiting for them by deficit
+    ///     round robin, so a busy account can not starve the others; each
+    ///     account may also have a rate of its own.
+    ///
+    /// Clients returned by the pool are ordinary clients and can be copied
+    /// and shared between threads; a client is cheap, keep one per account
+    /// or ask the pool each time. Clients keep the shared state alive, they
+    /// may outlive the pool.
+    ///
+    class ClientPool
+    {
+    public:
+
+        struct limits_t
+        {
+            /// requests of the account per round while slots are short
+            std::size_t weight;
+            /// requests per second, 0 is unlimited
+            std::uint64_t rate;
+        };
+
+        ///
+        /// \param slots requests in flight of all accounts, 0 is unlimited
+        ///
+        explicit ClientPool(std::size_t slots = 64);
+
+        ClientPool(const ClientPool&) = delete;
+
+        auto operator=(const ClientPool&) -> ClientPool& = delete;
+
+        ///
+        /// \brief client of account with token, the account is added on
+        ///     first use.
+        ///
+        auto client(const string& account, const string& token) -> Client;
+
+        ///
+        /// \brief sets limits of account, adding it if needed. Accounts
+        ///     have weight 1 and no rate by default.
+        ///
+        auto set_limits(const string& account, limits_t limits) -> void;
+
+        ///
+        /// \brief forgets account; clients already returned keep its share
+        ///     and limits.
+        ///
+        auto remove(const string& account) -> void;
+
+        auto size() const -> std::size_t;
+
+        ///
+        /// \brief counters of all accounts together.
+        ///
+        auto stats() const -> Client::stats_t;
+
+    private:
+
+        auto find(const string& account) -> std::shared_ptr<detail::tenant>;
+
+        Client m_base;
+        mutable std::mutex m_mutex;
+        std::map<string, std::shared_ptr<detail::tenant>> m_accounts;
+    };
+}
+
+#endif
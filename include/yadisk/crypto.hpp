@@ -0,0 +1,166 @@
+#ifndef YADISK_CRYPTO_HPP
+#define YADISK_CRYPTO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "yadisk/sink.hpp"
+#include "yadisk/source.hpp"
+
+namespace yadisk
+{
+    namespace detail
+    {
+        class ordered_pipeline;
+    }
+
+    ///
+    /// \brief layout of content encrypted with AES-256-GCM by
+    ///     encrypting_source: a header followed by frames, each frame is
+    ///     one chunk of plaintext and its 16 byte tag. Every frame is
+    ///     authenticated on its own, so any range of the plaintext can be
+    ///     decrypted from the frames covering it.
+    ///
+    /// The header holds a magic, the chunk size and a random nonce prefix;
+    /// the nonce of a frame is the prefix and the frame index. The last frame
+    /// is marked in its authenticated data, so truncation is detected.
+    ///
+    struct encrypted_layout
+    {
+        static const std::size_t header_size = 16;
+        static const std::size_t tag_size = 16;
+        static const std::size_t key_size = 32;
+
+        std::uint32_t chunk_size;
+        unsigned char nonce[8];
+
+        ///
+        /// \brief reads the layout from header_size bytes of header.
+        /// \return false if header is not a header of encrypted content
+        ///
+        static auto parse(const char * header, encrypted_layout& layout) -> bool;
+
+        auto frame_size() const -> std::size_t {
+            return chunk_size + tag_size;
+        }
+
+        auto frame_offset(std::uint64_t index) const -> std::uint64_t {
+            return header_size + index * frame_size();
+        }
+
+        auto frames(std::uint64_t encrypted_size) const -> std::uint64_t;
+
+        auto plaintext_size(std::uint64_t encrypted_size) const -> std::uint64_t;
+
+        ///
+        /// \brief decrypts frame index in place, leaving the plaintext chunk.
+        /// \param last whether it is the last frame of the content
+        /// \return false if the frame is not authentic
+        ///
+        auto decrypt(const std::string& key, std::uint64_t index, bool last, std::string& frame) const -> bool;
+
+        auto encrypt(const std::string& key, std::uint64_t index, bool last, std::string& chunk) const -> bool;
+    };
+
+    ///
+    /// \brief encrypts upstream on its way to the server. Chunks are read
+    ///     on a thread of the source and encrypted by workers, up to
+    ///     2 * workers chunks ahead of the upload, so encryption overlaps
+    ///     reading and sending. The thread starts with the first read, so
+    ///     upstream is untouched until the transfer starts.
+    ///
+    class encrypting_source : public source
+    {
+    public:
+
+        ///
+        /// \param key is 32 bytes of an AES-256 key
+        ///
+        encrypting_source(source& upstream, std::string key, std::size_t chunk_size = 1 << 20,
+                          std::size_t workers = std::thread::hardware_concurrency());
+
+        encrypting_source(const encrypting_source&) = delete;
+
+        auto operator=(const encrypting_source&) -> encrypting_source& = delete;
+
+        ~encrypting_source();
+
+        auto size() const -> std::int64_t override;
+
+        auto read(char * data, std::size_t size) -> std::size_t override;
+
+    private:
+
+        auto produce() -> void;
+
+        source& m_upstream;
+        std::string m_key;
+        encrypted_layout m_layout;
+        std::string m_current;
+        std::size_t m_position = 0;
+        std::unique_ptr<detail::ordered_pipeline> m_pipeline;
+        std::thread m_producer;
+    };
+
+    ///
+    /// \brief decrypts content made by encrypting_source into downstream.
+    ///     Frames are decrypted by workers and written to downstream in
+    ///     order by a thread of the sink.
+    ///
+    /// A frame which is not authentic aborts the transfer and the sink is
+    /// failed, close returns false. Downstream may have received the chunks
+    /// before it and is not closed.
+    ///
+    class decrypting_sink : public sink
+    {
+    public:
+
+        decrypting_sink(sink& downstream, std::string key,
+                        std::size_t workers = std::thread::hardware_concurrency());
+
+        decrypting_sink(const decrypting_sink&) = delete;
+
+        auto operator=(const decrypting_sink&) -> decrypting_sink& = delete;
+
+        ~decrypting_sink();
+
+        auto reserve(std::uint64_t size) -> void override;
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+        auto close() -> bool override;
+
+        ///
+        /// \brief whether the content was not encrypted, not authentic or
+        ///     downstream refused it. Known for sure after close.
+        ///
+        auto failed() const -> bool {
+            return m_failed;
+        }
+
+    private:
+
+        auto start() -> bool;
+
+        auto push_frame(bool last) -> bool;
+
+        auto consume() -> void;
+
+        sink& m_downstream;
+        std::string m_key;
+        std::size_t m_workers;
+        encrypted_layout m_layout;
+        std::string m_header;
+        std::string m_frame;
+        std::uint64_t m_reserved = 0;
+        bool m_failed = false;
+        bool m_closed = false;
+        std::unique_ptr<detail::ordered_pipeline> m_pipeline;
+        std::thread m_consumer;
+    };
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef YADISK_DOCUMENT_HPP
+#define YADISK_DOCUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace yadisk
+{
+    namespace detail
+    {
+        class arena;
+
+        ///
+        /// \brief memory for a node of a document: from the arena being
+        ///     filled on this thread, from the heap outside of parsing.
+        ///
+        auto arena_allocate(std::size_t size, std::size_t alignment) -> void *;
+
+        ///
+        /// \brief frees memory taken from the heap, memory of an arena is
+        ///     freed together with the arena.
+        ///
+        auto arena_deallocate(void * data, std::size_t size, std::size_t alignment) -> void;
+    }
+
+    ///
+    /// \brief allocator of arena_json. It has no state, so values of
+    ///     documents can be copied, moved and assigned like plain json.
+    ///
+    template <typename T>
+    class arena_allocator
+    {
+    public:
+
+        using value_type = T;
+
+        arena_allocator() = default;
+
+        template <typename U>
+        arena_allocator(const arena_allocator<U>&) {}
+
+        auto allocate(std::size_t n) -> T * {
+            return static_cast<T *>(detail::arena_allocate(n * sizeof(T), alignof(T)));
+        }
+
+        auto deallocate(T * data, std::size_t n) -> void {
+            detail::arena_deallocate(data, n * sizeof(T), alignof(T));
+        }
+    };
+
+    template <typename T, typename U>
+    auto operator==(const arena_allocator<T>&, const arena_allocator<U>&) -> bool {
+        return true;
+    }
+
+    template <typename T, typename U>
+    auto operator!=(const arena_allocator<T>&, const arena_allocator<U>&) -> bool {
+        return false;
+    }
+
+    using arena_string = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
+
+    ///
+    /// \brief json whose objects, arrays and strings are allocated with
+    ///     arena_allocator. Strings are arena_string, so they are read with
+    ///     get_ref<const arena_string&>() rather than get<std::string>().
+    ///
+    using arena_json = nlohmann::basic_json<std::map, std::vector, arena_string, bool,
+        std::int64_t, std::uint64_t, double, arena_allocator>;
+
+    ///
+    /// \brief parsed response whose nodes live in one arena: parsing takes a
+    ///     few large blocks from the heap instead of a block per string,
+    ///     array and object, and dropping the document frees them at once
+    ///     without walking the tree.
+    ///
+    /// Values added after parsing are allocated on the heap. The root and
+    /// values parsed into it must not outlive the document, a copy of them
+    /// made outside of parsing may.
+    ///
+    class document
+    {
+    public:
+
+        document();
+
+        document(document&& other);
+
+        auto operator=(document&& other) -> document&;
+
+        ~document();
+
+        ///
+        /// \brief parses text, throws as json::parse does on malformed text.
+        ///
+        static auto parse(const std::string& text) -> document;
+
+        auto root() -> arena_json& {
+            return m_root;
+        }
+
+        auto root() const -> const arena_json& {
+            return m_root;
+        }
+
+        ///
+        /// \return number of blocks the arena took from the heap.
+        ///
+        auto allocations() const -> std::size_t;
+
+        ///
+        /// \return bytes held by the arena.
+        ///
+        auto capacity() const -> std::size_t;
+
+    private:
+
+        // the root is destroyed before the arena its nodes live in
+        std::unique_ptr<detail::arena> m_arena;
+        arena_json m_root;
+    };
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef YADISK_INDEX_HPP
+#define YADISK_INDEX_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+namespace fs = boost::filesystem;
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    namespace detail
+    {
+        class mapped_file;
+    }
+
+    ///
+    /// \brief local index of the remote tree, kept in a memory mapped file.
+    ///     Entries are sorted by path and stored column by column (sizes,
+    ///     modification times, md5 sums, resource ids), so queries never touch
+    ///     the api: a lookup is a binary search and the size of a folder is
+    ///     a sum over a contiguous range.
+    ///
+    /// Paths are stored without "disk:" prefix, e.g. "/photos/1.jpg". The file
+    /// uses native byte order and is not meant to be moved between machines.
+    ///
+    class Index
+    {
+    public:
+
+        struct entry_t
+        {
+            string path;
+            std::uint64_t size;
+            std::int64_t modified;
+            string md5;
+            string resource_id;
+            bool directory;
+        };
+
+        ///
+        /// \brief opens the index stored in file, an absent file is an empty
+        ///     index.
+        ///
+        explicit Index(fs::path file);
+
+        Index(const Index&) = delete;
+
+        auto operator=(const Index&) -> Index& = delete;
+
+        ~Index();
+
+        ///
+        /// \brief walks root and replaces the index file.
+        /// \return false if the walk was incomplete, the index is kept then
+        ///
+        auto build(Client& client, url::path root = "/", std::size_t parallelism = 8) -> bool;
+
+        ///
+        /// \brief brings the index up to date without a full walk: descends
+        ///     only into directories whose modification time changed, and
+        ///     applies files from the last uploaded feed changed since the
+        ///     previous refresh. Files removed deep inside a directory which
+        ///     itself did not change are dropped by build only.
+        ///
+        auto refresh(Client& client, std::size_t parallelism = 8) -> bool;
+
+        auto size() const -> std::size_t;
+
+        ///
+        /// \return unix time when the index was built or refreshed, 0 for
+        ///     an empty index.
+        ///
+        auto refreshed() const -> std::int64_t;
+
+        auto find(const string& path) const -> boost::optional<entry_t>;
+
+        ///
+        /// \brief total size of files in folder and its subfolders.
+        ///
+        auto folder_size(const string& folder) const -> std::uint64_t;
+
+        ///
+        /// \brief direct children of folder.
+        ///
+        auto list(const string& folder) const -> std::vector<entry_t>;
+
+        ///
+        /// \brief all entries with the given name, in any folder.
+        ///
+        auto find_name(const string& name) const -> std::vector<entry_t>;
+
+    private:
+
+        auto open() -> void;
+
+        auto write(std::vector<entry_t>& entries, std::int64_t refreshed) -> void;
+
+        auto entry(std::size_t i) const -> entry_t;
+
+        auto path(std::size_t i) const -> string;
+
+        auto lower_bound(const string& path) const -> std::size_t;
+
+        fs::path m_path;
+        string m_root;
+        std::unique_ptr<detail::mapped_file> m_file;
+        std::size_t m_count = 0;
+        std::int64_t m_refreshed = 0;
+        const std::uint64_t * m_path_offsets = nullptr;
+        const std::uint64_t * m_id_offsets = nullptr;
+        const std::uint64_t * m_sizes = nullptr;
+        const std::int64_t * m_modified = nullptr;
+        const unsigned char * m_md5 = nullptr;
+        const unsigned char * m_flags = nullptr;
+        const char * m_pool = nullptr;
+    };
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef YADISK_PREVIEW_CACHE_HPP
+#define YADISK_PREVIEW_CACHE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    ///
+    /// \brief local cache of preview images, addressed by the content of
+    ///     the resource: a preview is stored under the md5 of the file,
+    ///     the preview size and crop, so renamed, moved or copied files
+    ///     share it and it is never fetched twice.
+    ///
+    /// Items are meta information of files as returned by info, list or
+    /// last_uploaded with preview_size and preview_crop options; items
+    /// without md5 or preview link are not cached.
+    ///
+    class PreviewCache
+    {
+    public:
+
+        explicit PreviewCache(fs::path directory);
+
+        ///
+        /// \brief path where the preview of item is cached, empty path if
+        ///     item can not be cached.
+        /// \param size is the preview_size option the item was listed with
+        ///
+        auto path(const json& item, const string& size, bool crop = false) const -> fs::path;
+
+        ///
+        /// \brief returns cached previews of items, fetching the missing
+        ///     ones concurrently, up to parallelism at a time, each distinct
+        ///     preview once.
+        /// \return paths of previews in the order of items, empty paths for
+        ///     items which could not be cached or fetched
+        ///
+        auto fetch(Client& client, const std::vector<json>& items, const string& size, bool crop = false,
+                   std::size_t parallelism = 8) -> std::vector<fs::path>;
+
+    private:
+
+        fs::path m_directory;
+    };
+}
+
+#endif
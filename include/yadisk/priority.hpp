@@ -0,0 +1,23 @@
+#ifndef YADISK_PRIORITY_HPP
+#define YADISK_PRIORITY_HPP
+
+namespace yadisk
+{
+    ///
+    /// \brief class of a transfer for the scheduler of a client. Each class
+    ///     has its own connection budget and bandwidth cap, so bulk
+    ///     transfers can not take the connections metadata calls need.
+    ///
+    /// Classes are ordered: a request runs in the lowest class allowed for
+    /// both the client and the kind of request, e.g. a download started by
+    /// an interactive client is bulk.
+    ///
+    enum class priority
+    {
+        interactive,
+        bulk,
+        background
+    };
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef YADISK_REMOTE_FILE_HPP
+#define YADISK_REMOTE_FILE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "yadisk/client.hpp"
+
+namespace yadisk
+{
+    ///
+    /// \brief random access to a file on disk without downloading it:
+    ///     reads are served from a cache of fixed size blocks, and missing
+    ///     blocks are fetched with http range requests.
+    ///
+    /// Missing blocks next to each other are fetched with one request, and
+    /// separate runs of them concurrently. A read which continues the
+    /// previous one also fetches blocks ahead, twice as many each time up
+    /// to max_readahead. Threads reading the same block wait for a single
+    /// fetch. The size is learnt by fetching the last block, so reading a
+    /// footer costs one small range request after the download link.
+    ///
+    class RemoteFile
+    {
+    public:
+
+        static const std::size_t max_readahead = 16;
+
+        ///
+        /// \param block_size is the unit of fetching and caching
+        /// \param capacity is the number of blocks kept in the cache
+        ///
+        RemoteFile(Client client, url::path path, std::size_t block_size = 256 << 10, std::size_t capacity = 64);
+
+        RemoteFile(const RemoteFile&) = delete;
+
+        auto operator=(const RemoteFile&) -> RemoteFile& = delete;
+
+        auto size() -> result<std::uint64_t>;
+
+        ///
+        /// \brief reads up to size bytes at offset into data.
+        /// \return number of bytes read, fewer than size only at the end
+        ///     of the file
+        ///
+        auto pread(char * data, std::size_t size, std::uint64_t offset) -> result<std::size_t>;
+
+        ///
+        /// \brief range requests made so far.
+        ///
+        auto requests() const -> std::uint64_t {
+            return m_requests.load(std::memory_order_relaxed);
+        }
+
+    private:
+
+        using block_ptr = std::shared_ptr<const std::string>;
+
+        struct range_t
+        {
+            string bytes;
+            string data;
+            string headers;
+            long http_code;
+            // announced length of the answer, -1 if unknown
+            std::int64_t length;
+            // the answer was longer than the range and cut off
+            bool truncated;
+        };
+
+        auto href(bool renew) -> result<string>;
+
+        auto fetch(std::vector<range_t>& ranges) -> error_t;
+
+        auto fetch(const std::vector<std::uint64_t>& blocks, std::map<std::uint64_t, block_ptr>& fetched) -> error_t;
+
+        auto store(std::uint64_t index, block_ptr block) -> void;
+
+        Client m_client;
+        url::path m_path;
+        std::size_t m_block_size;
+        std::size_t m_capacity;
+        std::atomic<std::uint64_t> m_requests{0};
+
+        std::mutex m_open_mutex;
+        bool m_opened = false;
+        std::uint64_t m_size = 0;
+
+        std::mutex m_mutex;
+        std::condition_variable m_fetched;
+        string m_href;
+        std::list<std::pair<std::uint64_t, block_ptr>> m_lru;
+        std::map<std::uint64_t, std::list<std::pair<std::uint64_t, block_ptr>>::iterator> m_blocks;
+        std::set<std::uint64_t> m_in_flight;
+        std::uint64_t m_next_offset = 0;
+        std::size_t m_readahead = 0;
+    };
+}
+
+#endif
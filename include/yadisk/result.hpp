@@ -0,0 +1,79 @@
+#ifndef YADISK_RESULT_HPP
+#define YADISK_RESULT_HPP
+
+#include <string>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+namespace yadisk
+{
+    ///
+    /// \brief kind of failure of a call.
+    ///
+    enum class errc
+    {
+        ok = 0,
+        /// no http response, see error_t::transport for the curl code
+        transport,
+        /// the api or the storage answered with an error status
+        api,
+        /// the response body is not valid json
+        parse,
+        /// the call was not made, e.g. its options are malformed
+        invalid
+    };
+
+    struct error_t
+    {
+        errc code = errc::ok;
+        /// CURLcode of a transport failure
+        int transport = 0;
+        /// status of the http response, 0 if there was none
+        long http_code = 0;
+        /// name of the api error, e.g. "DiskNotFoundError"
+        std::string name;
+        /// body of the error response as returned by the api
+        json details;
+    };
+
+    ///
+    /// \brief value of a call or the cause of its failure. Failures are
+    ///     reported without exceptions, so expected errors such as a missing
+    ///     resource cost no more than success and can be told apart cheaply,
+    ///     e.g. by retry logic.
+    ///
+    template <typename T>
+    class result
+    {
+    public:
+
+        result(T value) : m_value(std::move(value)) {}
+
+        result(error_t error) : m_error(std::move(error)) {}
+
+        explicit operator bool() const {
+            return m_error.code == errc::ok;
+        }
+
+        auto value() -> T& {
+            return m_value;
+        }
+
+        auto value() const -> const T& {
+            return m_value;
+        }
+
+        auto error() const -> const error_t& {
+            return m_error;
+        }
+
+    private:
+
+        T m_value;
+        error_t m_error;
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef YADISK_SCANNER_HPP
+#define YADISK_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+namespace yadisk
+{
+    ///
+    /// \brief walks a local tree with several threads, e.g. to build the
+    ///     files of Client::upload or the directories of Client::mkdir.
+    ///
+    /// Every thread lists directories from its own queue and takes work
+    /// from the queues of others when its own is empty, so a deep branch
+    /// does not keep the other threads idle. On posix systems entries are
+    /// read with readdir and fstatat relative to the open directory, which
+    /// saves resolving the full path of every file. Symbolic links and
+    /// special files are skipped.
+    ///
+    class Scanner
+    {
+    public:
+
+        struct entry_t
+        {
+            fs::path path;
+            std::uint64_t size;
+            /// unix time of the last modification
+            std::int64_t modified;
+            /// 0 where the file system has no inode numbers
+            std::uint64_t inode;
+            bool directory;
+        };
+
+        explicit Scanner(std::size_t threads = 8);
+
+        ///
+        /// \brief walks root and passes every file and directory below it
+        ///     to visit, in no particular order but a directory before its
+        ///     entries. visit is called on the calling thread while the
+        ///     walk goes on, returning false stops it.
+        /// \return false if the walk was incomplete, e.g. a directory could
+        ///     not be read or visit stopped it
+        ///
+        auto scan(fs::path root, std::function<bool(const entry_t& entry)> visit) -> bool;
+
+    private:
+
+        std::size_t m_threads;
+    };
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef YADISK_SINK_HPP
+#define YADISK_SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <ostream>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include "yadisk/cancellation.hpp"
+
+namespace yadisk
+{
+    ///
+    /// \brief destination of downloaded data. Chunks are passed straight from
+    ///     the receive buffer of curl, without intermediate copies.
+    ///
+    /// A sink applies backpressure by blocking in write: while it blocks curl
+    /// stops reading the socket and the server is throttled by tcp.
+    ///
+    class sink
+    {
+    public:
+
+        virtual ~sink() = default;
+
+        ///
+        /// \brief is called once before the first chunk when the length of
+        ///     the content is known.
+        ///
+        virtual auto reserve(std::uint64_t /*size*/) -> void {}
+
+        ///
+        /// \return false to abort the transfer
+        ///
+        virtual auto write(const char * data, std::size_t size) -> bool = 0;
+
+        ///
+        /// \brief is called after the last chunk of a successful transfer.
+        /// \return false if the data could not be stored after all, e.g. a
+        ///     file failed to flush
+        ///
+        virtual auto close() -> bool {
+            return true;
+        }
+    };
+
+    ///
+    /// \brief writes into a caller provided buffer, the transfer fails if the
+    ///     content does not fit.
+    ///
+    class buffer_sink : public sink
+    {
+    public:
+
+        buffer_sink(char * data, std::size_t capacity) : m_data{data}, m_capacity{capacity} {}
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+        auto size() const -> std::size_t {
+            return m_size;
+        }
+
+    private:
+
+        char * m_data;
+        std::size_t m_capacity;
+        std::size_t m_size = 0;
+    };
+
+    class stream_sink : public sink
+    {
+    public:
+
+        explicit stream_sink(std::ostream& stream) : m_stream(stream) {}
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+    private:
+
+        std::ostream& m_stream;
+    };
+
+    ///
+    /// \brief passes chunks to a callback, e.g. to a decompressor.
+    ///
+    class callback_sink : public sink
+    {
+    public:
+
+        using callback_t = std::function<bool(const char * data, std::size_t size)>;
+
+        explicit callback_sink(callback_t callback) : m_callback{callback} {}
+
+        auto write(const char * data, std::size_t size) -> bool override {
+            return m_callback(data, size);
+        }
+
+    private:
+
+        callback_t m_callback;
+    };
+
+    ///
+    /// \brief writes into a local file, truncating it.
+    ///
+    class file_sink : public sink
+    {
+    public:
+
+        explicit file_sink(fs::path path);
+
+        ~file_sink();
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+        auto close() -> bool override;
+
+    private:
+
+        std::FILE * m_file;
+    };
+
+#ifndef _WIN32
+    ///
+    /// \brief copies chunks into a memory mapped file: the file is sized up
+    ///     front from the content length, so data goes directly to the page
+    ///     cache without write calls. Without a known length the mapping
+    ///     grows geometrically and is trimmed on close.
+    ///
+    class mapped_file_sink : public sink
+    {
+    public:
+
+        explicit mapped_file_sink(fs::path path);
+
+        ~mapped_file_sink();
+
+        auto reserve(std::uint64_t size) -> void override;
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+        auto close() -> bool override;
+
+    private:
+
+        auto remap(std::size_t capacity) -> bool;
+
+        int m_fd;
+        char * m_data = nullptr;
+        std::size_t m_capacity = 0;
+        std::size_t m_size = 0;
+    };
+
+    ///
+    /// \brief writes into a file descriptor, e.g. a pipe to another process.
+    ///     A full pipe blocks the transfer until the reader catches up, also
+    ///     for non-blocking descriptors, or until cancelled is cancelled.
+    ///
+    class fd_sink : public sink
+    {
+    public:
+
+        explicit fd_sink(int fd, cancellation cancelled = cancellation{}) : m_fd{fd}, m_cancelled{cancelled} {}
+
+        auto write(const char * data, std::size_t size) -> bool override;
+
+    private:
+
+        int m_fd;
+        cancellation m_cancelled;
+    };
+#endif
+}
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef YADISK_SOURCE_HPP
+#define YADISK_SOURCE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+namespace yadisk
+{
+    ///
+    /// \brief origin of uploaded data, pulled by curl chunk by chunk.
+    ///
+    class source
+    {
+    public:
+
+        ///
+        /// \brief is returned by read to abort the transfer.
+        ///
+        static const std::size_t abort = static_cast<std::size_t>(-1);
+
+        virtual ~source() = default;
+
+        ///
+        /// \return length of the content if it is known in advance, -1 for
+        ///     content sent with chunked transfer encoding.
+        ///
+        virtual auto size() const -> std::int64_t {
+            return -1;
+        }
+
+        ///
+        /// \return count of bytes put into data, 0 at the end of content or
+        ///     source::abort on errors.
+        ///
+        virtual auto read(char * data, std::size_t size) -> std::size_t = 0;
+    };
+
+    class stream_source : public source
+    {
+    public:
+
+        explicit stream_source(std::istream& stream) : m_stream(stream) {}
+
+        auto read(char * data, std::size_t size) -> std::size_t override;
+
+    private:
+
+        std::istream& m_stream;
+    };
+
+    ///
+    /// \brief pulls data from a callback with the signature of source::read.
+    ///
+    class callback_source : public source
+    {
+    public:
+
+        using callback_t = std::function<std::size_t(char * data, std::size_t size)>;
+
+        explicit callback_source(callback_t callback) : m_callback{callback} {}
+
+        auto read(char * data, std::size_t size) -> std::size_t override {
+            return m_callback(data, size);
+        }
+
+    private:
+
+        callback_t m_callback;
+    };
+
+    class file_source : public source
+    {
+    public:
+
+        explicit file_source(fs::path path);
+
+        ~file_source();
+
+        auto size() const -> std::int64_t override {
+            return m_size;
+        }
+
+        auto read(char * data, std::size_t size) -> std::size_t override;
+
+    private:
+
+        std::FILE * m_file;
+        std::int64_t m_size;
+    };
+
+    ///
+    /// \brief runs an upstream source on its own thread and hands its data
+    ///     to curl through a bounded ring buffer, so producing the content
+    ///     and sending it overlap. The producer blocks while the buffer is
+    ///     full, i.e. it never runs ahead of the network by more than the
+    ///     capacity.
+    ///
+    /// The producer starts with the first read, so nothing is taken from
+    /// upstream before the transfer begins, e.g. while its link is fetched.
+    ///
+    class buffered_source : public source
+    {
+    public:
+
+        ///
+        /// \param capacity bytes of the ring buffer, at least 1
+        ///
+        buffered_source(source& upstream, std::size_t capacity = 4 << 20);
+
+        buffered_source(const buffered_source&) = delete;
+
+        auto operator=(const buffered_source&) -> buffered_source& = delete;
+
+        ///
+        /// \brief stops the producer thread, even if the content was not
+        ///     consumed completely.
+        ///
+        ~buffered_source();
+
+        auto size() const -> std::int64_t override {
+            return m_upstream.size();
+        }
+
+        auto read(char * data, std::size_t size) -> std::size_t override;
+
+    private:
+
+        auto produce() -> void;
+
+        source& m_upstream;
+        std::vector<char> m_buffer;
+        std::size_t m_head = 0;
+        std::size_t m_filled = 0;
+        bool m_finished = false;
+        bool m_failed = false;
+        bool m_cancelled = false;
+        std::mutex m_mutex;
+        std::condition_variable m_readable;
+        std::condition_variable m_writable;
+        std::thread m_producer;
+    };
+}
+
+#endif
@@ -0,0 +1,402 @@
+#include <curl/curl.h>
+
+#include <yadisk/async_client.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <chrono>
+#include <deque>
+#include <map>
+
+#include "context.hpp"
+#include "request.hpp"
+
+namespace yadisk
+{
+	class curl_category_impl : public boost::system::error_category
+	{
+	public:
+		auto name() const BOOST_SYSTEM_NOEXCEPT -> const char * override {
+			return "curl";
+		}
+		auto message(int ev) const -> std::string override {
+			return curl_easy_strerror(static_cast<CURLcode>(ev));
+		}
+	};
+
+	auto curl_category() -> const boost::system::error_category& {
+		static const curl_category_impl category;
+		return category;
+	}
+
+	///
+	/// \brief owns the multi handle and the sockets it uses. Sockets are opened
+	///     by asio on behalf of curl, so asio can wait for their readiness;
+	///     connections stay in the cache of the multi handle, only dns and
+	///     tls sessions come from the share handle.
+	///
+	class AsyncClient::impl : public std::enable_shared_from_this<AsyncClient::impl>
+	{
+	public:
+
+		using completion_t = std::function<void(boost::system::error_code, detail::request&)>;
+
+		impl(boost::asio::io_context& io, std::shared_ptr<detail::context> context)
+			: m_io(io), m_strand(io), m_timer(io), m_ticker(io), m_context{context} {
+			m_multi = curl_multi_init();
+			if (m_multi == nullptr) {
+				throw std::runtime_error("curl_multi_init");
+			}
+			curl_multi_setopt(m_multi, CURLMOPT_SOCKETFUNCTION, &impl::on_socket);
+			curl_multi_setopt(m_multi, CURLMOPT_SOCKETDATA, this);
+			curl_multi_setopt(m_multi, CURLMOPT_TIMERFUNCTION, &impl::on_timer);
+			curl_multi_setopt(m_multi, CURLMOPT_TIMERDATA, this);
+		}
+
+		~impl() {
+			m_stopped = true;
+			for (auto& item : m_transfers) {
+				curl_multi_remove_handle(m_multi, item.first);
+				m_context->release(*item.second->request);
+			}
+			curl_multi_cleanup(m_multi);
+		}
+
+		auto start(std::shared_ptr<detail::request> request, completion_t on_done) -> void {
+			auto self = shared_from_this();
+			boost::asio::post(m_strand, [self, request, on_done]() {
+				self->add(request, on_done);
+			});
+		}
+
+		///
+		/// \brief fails every transfer in flight, the multi handle itself
+		///     lives until the last pending socket or timer wait completes.
+		///
+		auto stop() -> void {
+			auto self = shared_from_this();
+			boost::asio::post(m_strand, [self]() {
+				self->m_stopped = true;
+				self->m_timer.cancel();
+				self->m_ticker.cancel();
+				auto transfers = std::move(self->m_transfers);
+				self->m_transfers.clear();
+				auto pending = std::move(self->m_pending);
+				self->m_pending.clear();
+				for (auto& item : transfers) {
+					curl_multi_remove_handle(self->m_multi, item.first);
+					self->m_context->release(*item.second->request);
+					item.second->on_done(boost::asio::error::operation_aborted, *item.second->request);
+				}
+				for (auto& item : pending) {
+					item->on_done(boost::asio::error::operation_aborted, *item->request);
+				}
+			});
+		}
+
+	private:
+
+		struct watched_socket
+		{
+			explicit watched_socket(boost::asio::io_context& io) : socket(io) {}
+
+			boost::asio::ip::tcp::socket socket;
+			int action = 0;
+			bool reading = false;
+			bool writing = false;
+			bool closed = false;
+		};
+
+		struct transfer
+		{
+			std::shared_ptr<detail::request> request;
+			completion_t on_done;
+		};
+
+		auto add(std::shared_ptr<detail::request> request, completion_t on_done) -> void {
+			if (m_stopped) {
+				on_done(boost::asio::error::operation_aborted, *request);
+				return;
+			}
+			m_pending.push_back(std::make_shared<transfer>(transfer{request, on_done}));
+			start_pending();
+			tick();
+		}
+
+		///
+		/// \brief starts waiting transfers while connections of their class
+		///     and turns of their account are free; the scheduler is shared
+		///     with Client, so its lanes hold for both.
+		///
+		auto start_pending() -> void {
+			while (not m_pending.empty() && m_context->try_acquire(*m_pending.front()->request)) {
+				auto item = m_pending.front();
+				m_pending.pop_front();
+				launch(item);
+			}
+		}
+
+		auto launch(std::shared_ptr<transfer> item) -> void {
+			auto& request = item->request;
+			// the deadline may have passed or the request been cancelled
+			// while it waited for its turn
+			auto aborted = request->aborted();
+			if (aborted != CURLE_OK) {
+				m_context->release(*request);
+				item->on_done(boost::system::error_code(aborted, curl_category()), *request);
+				return;
+			}
+
+			request->set_scheduler(m_context->lanes);
+			auto curl = request->prepare();
+			curl_easy_setopt(curl, CURLOPT_SHARE, m_context->share());
+			curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, &impl::open_socket);
+			curl_easy_setopt(curl, CURLOPT_OPENSOCKETDATA, this);
+			curl_easy_setopt(curl, CURLOPT_CLOSESOCKETFUNCTION, &impl::close_socket);
+			curl_easy_setopt(curl, CURLOPT_CLOSESOCKETDATA, this);
+
+			m_transfers[curl] = item;
+			if (curl_multi_add_handle(m_multi, curl) != CURLM_OK) {
+				m_transfers.erase(curl);
+				m_context->release(*request);
+				item->on_done(boost::system::error_code(CURLE_FAILED_INIT, curl_category()), *request);
+			}
+		}
+
+		///
+		/// \brief polls for what curl does not report through sockets or its
+		///     timer: transfers waiting for a connection held by another
+		///     thread and transfers whose bandwidth pause is over.
+		///
+		auto tick() -> void {
+			if (m_stopped || m_ticking) return;
+			auto now = std::chrono::steady_clock::now();
+			auto wait = std::chrono::steady_clock::duration::max();
+			for (auto& item : m_transfers) {
+				auto paused = item.second->request->resume(now);
+				if (paused > std::chrono::steady_clock::duration::zero()) {
+					wait = std::min(wait, paused);
+				}
+			}
+			if (not m_pending.empty()) {
+				wait = std::min<std::chrono::steady_clock::duration>(wait, std::chrono::milliseconds(10));
+			}
+			if (wait == std::chrono::steady_clock::duration::max()) return;
+
+			m_ticking = true;
+			auto self = shared_from_this();
+			m_ticker.expires_after(wait);
+			m_ticker.async_wait(boost::asio::bind_executor(m_strand, [self](boost::system::error_code ec) {
+				self->m_ticking = false;
+				if (ec || self->m_stopped) return;
+				auto now = std::chrono::steady_clock::now();
+				for (auto& item : self->m_transfers) {
+					item.second->request->resume(now);
+				}
+				self->start_pending();
+				self->act(CURL_SOCKET_TIMEOUT, 0);
+			}));
+		}
+
+		auto arm(std::shared_ptr<watched_socket> watched, curl_socket_t s) -> void {
+			auto self = shared_from_this();
+			if ((watched->action & CURL_POLL_IN) && !watched->reading) {
+				watched->reading = true;
+				watched->socket.async_wait(boost::asio::ip::tcp::socket::wait_read,
+					boost::asio::bind_executor(m_strand, [self, watched, s](boost::system::error_code ec) {
+						watched->reading = false;
+						if (watched->closed || self->m_stopped) return;
+						// a wait cancelled by CURL_POLL_REMOVE is not an error,
+						// the socket is armed again if curl watches it anew
+						if (ec != boost::asio::error::operation_aborted) {
+							self->act(s, ec ? CURL_CSELECT_ERR : CURL_CSELECT_IN);
+						}
+						if (!watched->closed) self->arm(watched, s);
+					}));
+			}
+			if ((watched->action & CURL_POLL_OUT) && !watched->writing) {
+				watched->writing = true;
+				watched->socket.async_wait(boost::asio::ip::tcp::socket::wait_write,
+					boost::asio::bind_executor(m_strand, [self, watched, s](boost::system::error_code ec) {
+						watched->writing = false;
+						if (watched->closed || self->m_stopped) return;
+						if (ec != boost::asio::error::operation_aborted) {
+							self->act(s, ec ? CURL_CSELECT_ERR : CURL_CSELECT_OUT);
+						}
+						if (!watched->closed) self->arm(watched, s);
+					}));
+			}
+		}
+
+		auto act(curl_socket_t s, int events) -> void {
+			int running = 0;
+			curl_multi_socket_action(m_multi, s, events, &running);
+			check_multi_info();
+			tick();
+		}
+
+		auto check_multi_info() -> void {
+			CURLMsg * message = nullptr;
+			int left = 0;
+			while ((message = curl_multi_info_read(m_multi, &left)) != nullptr) {
+				if (message->msg != CURLMSG_DONE) continue;
+
+				CURL * curl = message->easy_handle;
+				CURLcode result = message->data.result;
+				curl_multi_remove_handle(m_multi, curl);
+
+				auto it = m_transfers.find(curl);
+				if (it == m_transfers.end()) continue;
+				auto done = it->second;
+				m_transfers.erase(it);
+
+				m_context->release(*done->request);
+				m_context->account(curl, result);
+				start_pending();
+				boost::system::error_code ec;
+				if (result != CURLE_OK) {
+					ec = boost::system::error_code(result, curl_category());
+				}
+				done->on_done(ec, *done->request);
+			}
+		}
+
+		static int on_socket(CURL *, curl_socket_t s, int what, void * userp, void *) {
+			auto self = reinterpret_cast<impl *>(userp);
+			if (self->m_stopped) return 0;
+
+			auto it = self->m_sockets.find(s);
+			if (it == self->m_sockets.end()) return 0;
+
+			if (what == CURL_POLL_REMOVE) {
+				// the connection goes idle in the cache, its waits must not
+				// report it to curl any more
+				boost::system::error_code ec;
+				it->second->action = 0;
+				it->second->socket.cancel(ec);
+				return 0;
+			}
+			it->second->action = what;
+			self->arm(it->second, s);
+			return 0;
+		}
+
+		static int on_timer(CURLM *, long timeout_ms, void * userp) {
+			auto self = reinterpret_cast<impl *>(userp);
+			if (self->m_stopped) return 0;
+
+			if (timeout_ms < 0) {
+				self->m_timer.cancel();
+				return 0;
+			}
+
+			auto owner = self->shared_from_this();
+			self->m_timer.expires_after(std::chrono::milliseconds(timeout_ms));
+			self->m_timer.async_wait(boost::asio::bind_executor(self->m_strand, [owner](boost::system::error_code ec) {
+				if (ec || owner->m_stopped) return;
+				owner->act(CURL_SOCKET_TIMEOUT, 0);
+			}));
+			return 0;
+		}
+
+		static curl_socket_t open_socket(void * clientp, curlsocktype purpose, curl_sockaddr * address) {
+			auto self = reinterpret_cast<impl *>(clientp);
+			if (purpose != CURLSOCKTYPE_IPCXN) return CURL_SOCKET_BAD;
+
+			std::shared_ptr<watched_socket> watched = std::make_shared<watched_socket>(self->m_io);
+			boost::system::error_code ec;
+			if (address->family == AF_INET) {
+				watched->socket.open(boost::asio::ip::tcp::v4(), ec);
+			}
+			else if (address->family == AF_INET6) {
+				watched->socket.open(boost::asio::ip::tcp::v6(), ec);
+			}
+			else {
+				return CURL_SOCKET_BAD;
+			}
+			if (ec) return CURL_SOCKET_BAD;
+
+			auto s = watched->socket.native_handle();
+			self->m_sockets[s] = watched;
+			return s;
+		}
+
+		static int close_socket(void * clientp, curl_socket_t s) {
+			auto self = reinterpret_cast<impl *>(clientp);
+			auto it = self->m_sockets.find(s);
+			if (it == self->m_sockets.end()) return 0;
+
+			boost::system::error_code ec;
+			it->second->closed = true;
+			it->second->socket.close(ec);
+			self->m_sockets.erase(it);
+			return 0;
+		}
+
+		boost::asio::io_context& m_io;
+		boost::asio::io_context::strand m_strand;
+		boost::asio::steady_timer m_timer;
+		boost::asio::steady_timer m_ticker;
+		std::shared_ptr<detail::context> m_context;
+		CURLM * m_multi;
+		bool m_stopped = false;
+		bool m_ticking = false;
+		std::deque<std::shared_ptr<transfer>> m_pending;
+		std::map<curl_socket_t, std::shared_ptr<watched_socket>> m_sockets;
+		std::map<CURL *, std::shared_ptr<transfer>> m_transfers;
+	};
+
+	AsyncClient::AsyncClient(boost::asio::io_context& io, Client client)
+		: m_io(io), m_client{client},
+		  m_impl{std::make_shared<impl>(io, client.m_context)} {}
+
+	AsyncClient::~AsyncClient() {
+		m_impl->stop();
+	}
+
+	static auto parse_response(detail::request& request, boost::system::error_code& ec) -> json {
+		if (ec) return json();
+		try {
+			return json::parse(request.response());
+		}
+		catch(...) {
+			ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+			return json();
+		}
+	}
+
+	auto AsyncClient::start_ping(bool_handler_t handler) -> void {
+		std::shared_ptr<detail::request> request = m_client.ping_request();
+		m_impl->start(request, [handler](boost::system::error_code ec, detail::request& request) {
+			handler(ec, !ec && request.http_code() == 200);
+		});
+	}
+
+	auto AsyncClient::start_info(url::path resource, json options, json_handler_t handler) -> void {
+		std::shared_ptr<detail::request> request = m_client.info_request(resource, options);
+		m_impl->start(request, [handler](boost::system::error_code ec, detail::request& request) {
+			auto result = parse_response(request, ec);
+			handler(ec, result);
+		});
+	}
+
+	auto AsyncClient::start_copy(url::path from, url::path to, bool overwrite, std::list<string> fields, json_handler_t handler) -> void {
+		std::shared_ptr<detail::request> request = m_client.copy_request(from, to, overwrite, fields);
+		m_impl->start(request, [handler](boost::system::error_code ec, detail::request& request) {
+			auto result = parse_response(request, ec);
+			handler(ec, result);
+		});
+	}
+
+	auto AsyncClient::start_patch(url::path resource, json meta, std::list<string> fields, json_handler_t handler) -> void {
+		std::shared_ptr<detail::request> request = m_client.patch_request(resource, meta, fields);
+		m_impl->start(request, [handler](boost::system::error_code ec, detail::request& request) {
+			auto result = parse_response(request, ec);
+			handler(ec, result);
+		});
+	}
+}
@@ -0,0 +1,298 @@
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "batch.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	static const std::size_t max_attempts = 4;
+	// backoff of the first retry, doubled with every attempt
+	static const std::chrono::milliseconds base_retry_delay{200};
+	// a longer Retry-After is an answer rather than a reason to wait
+	static const std::chrono::seconds max_retry_delay{30};
+
+	// time the server took to answer: from the request sent to the first
+	// byte of the response, without dns, connect and tls of a new connection
+	static auto response_time(CURL * curl) -> double {
+#if LIBCURL_VERSION_NUM >= 0x073d00
+		curl_off_t sent = 0, answered = 0;
+		curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &sent);
+		curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &answered);
+		return std::max<curl_off_t>(answered - sent, 0) / 1e6;
+#else
+		double sent = 0, answered = 0;
+		curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME, &sent);
+		curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &answered);
+		return std::max(answered - sent, 0.0);
+#endif
+	}
+
+	// scheme://host[:port] of url, the key of its limit
+	static auto host_of(const std::string& url) -> std::string {
+		auto start = url.find("://");
+		start = start == std::string::npos ? 0 : start + 3;
+		return url.substr(0, url.find_first_of("/?#", start));
+	}
+
+	batch::batch(context& context, std::size_t parallelism, bool adaptive)
+		: m_context(context), m_parallelism{std::max<std::size_t>(parallelism, 1)}, m_adaptive{adaptive},
+		  m_recorder{context.recording()}, m_player{context.replaying()},
+		  m_multi{curl_multi_init()} {
+		if (m_multi == nullptr) {
+			throw std::runtime_error("curl_multi_init");
+		}
+	}
+
+	batch::~batch() {
+		for (auto& item : m_running) {
+			if (item.second.recorded == nullptr) {
+				curl_multi_remove_handle(m_multi, item.first);
+			}
+			m_context.release(*item.second.request);
+			if (not item.second.host.empty()) {
+				m_context.limits.release(item.second.host);
+			}
+		}
+		m_running.clear();
+		curl_multi_cleanup(m_multi);
+	}
+
+	auto batch::add(std::unique_ptr<request> request, completion_t on_done) -> void {
+		m_pending.push_back(transfer{std::move(request), on_done, 0, 0, nullptr, {}, {}});
+	}
+
+	auto batch::start_pending() -> void {
+		// accounts over their rate or without a free slot, classes without
+		// a free connection and hosts at their limit: their requests stay
+		// pending while the others go ahead. Completions may add requests,
+		// so the position is an index rather than an iterator.
+		std::vector<std::pair<const tenant *, priority>> blocked;
+		std::vector<std::string> blocked_hosts;
+		std::size_t next = 0;
+		while (m_running.size() < m_parallelism && not m_pending.empty()) {
+			std::string host;
+			if (next == m_pending.size()) {
+				// with nothing running there is nothing else to wait for,
+				// otherwise the transfers wait for a connection to be free
+				if (not m_running.empty()) break;
+				next = 0;
+				if (not m_context.acquire(*m_pending.front().request)) {
+					auto item = std::move(m_pending.front());
+					m_pending.pop_front();
+					item.on_done(item.request->aborted(), *item.request);
+					continue;
+				}
+				if (m_adaptive) {
+					host = host_of(m_pending.front().request->url());
+					m_context.limits.acquire(host);
+				}
+			}
+			else {
+				auto& request = *m_pending[next].request;
+				auto key = std::make_pair(static_cast<const tenant *>(request.tenant()), request.priority());
+				if (std::find(blocked.begin(), blocked.end(), key) != blocked.end()) {
+					++next;
+					continue;
+				}
+				if (m_adaptive) {
+					host = host_of(request.url());
+					if (std::find(blocked_hosts.begin(), blocked_hosts.end(), host) != blocked_hosts.end()) {
+						++next;
+						continue;
+					}
+					if (not m_context.limits.try_acquire(host)) {
+						blocked_hosts.push_back(host);
+						++next;
+						continue;
+					}
+				}
+				if (not m_context.try_acquire(request)) {
+					if (not host.empty()) {
+						m_context.limits.release(host);
+					}
+					blocked.push_back(key);
+					++next;
+					continue;
+				}
+			}
+			auto item = std::move(m_pending[next]);
+			m_pending.erase(m_pending.begin() + static_cast<std::ptrdiff_t>(next));
+			item.host = host;
+
+			auto aborted = item.request->aborted();
+			if (aborted != CURLE_OK) {
+				m_context.release(*item.request);
+				if (not item.host.empty()) {
+					m_context.limits.release(item.host);
+				}
+				item.on_done(aborted, *item.request);
+				continue;
+			}
+
+			if (m_player != nullptr) {
+				// nothing is sent, the transfer is due after its recorded duration
+				item.recorded = m_player->find(*item.request);
+				item.ready = std::chrono::steady_clock::now() + m_player->delay(item.recorded);
+				auto curl = item.request->handle();
+				m_running[curl] = std::move(item);
+				continue;
+			}
+
+			item.request->set_scheduler(m_context.lanes);
+			auto curl = item.request->prepare();
+			curl_easy_setopt(curl, CURLOPT_SHARE, m_context.share());
+			if (curl_multi_add_handle(m_multi, curl) != CURLM_OK) {
+				m_context.release(*item.request);
+				m_context.account(curl, CURLE_FAILED_INIT);
+				item.on_done(CURLE_FAILED_INIT, *item.request);
+				continue;
+			}
+			item.started = m_recorder != nullptr ? m_recorder->elapsed() : 0;
+			m_running[curl] = std::move(item);
+		}
+	}
+
+	auto batch::finish(CURL * curl, CURLcode result) -> void {
+		auto it = m_running.find(curl);
+		if (it == m_running.end()) return;
+		auto item = std::move(it->second);
+		m_running.erase(it);
+
+		m_context.release(*item.request);
+		if (m_player != nullptr) {
+			m_context.account(item.recorded, result);
+		}
+		else {
+			m_context.account(curl, result);
+		}
+
+		auto http_code = result == CURLE_OK ? item.request->http_code() : 0;
+		auto throttled = http_code == 429 || http_code == 503;
+		auto latency = m_player == nullptr ? response_time(curl)
+			: item.recorded != nullptr ? item.recorded->duration / 1e6 : 0.0;
+		if (not item.host.empty()) {
+			m_context.limits.release(item.host);
+			m_context.limits.update(item.host, latency, throttled);
+			item.host.clear();
+		}
+		if (m_recorder != nullptr) {
+			m_recorder->record(*item.request, result, item.started, m_recorder->elapsed() - item.started);
+		}
+		if (throttled && item.attempts + 1 < max_attempts) {
+			auto delay = retry_delay(curl, item);
+			if (delay >= std::chrono::steady_clock::duration::zero() && item.request->rewind()) {
+				++item.attempts;
+				item.ready = std::chrono::steady_clock::now() + delay;
+				m_delayed.push_back(std::move(item));
+				return;
+			}
+		}
+		item.on_done(result, *item.request);
+	}
+
+	auto batch::retry_delay(CURL * curl, const transfer& item) -> std::chrono::steady_clock::duration {
+		curl_off_t retry_after = 0;
+#if LIBCURL_VERSION_NUM >= 0x074200
+		if (m_player == nullptr) {
+			curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retry_after);
+		}
+#else
+		(void)curl;
+#endif
+		if (retry_after > 0) {
+			if (retry_after > max_retry_delay.count()) return std::chrono::steady_clock::duration{-1};
+			return std::chrono::seconds(retry_after);
+		}
+
+		// half of the backoff is fixed, the other half random
+		static thread_local std::minstd_rand random{std::random_device{}()};
+		auto backoff = base_retry_delay * (1 << item.attempts);
+		std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter{0, backoff.count() / 2};
+		return backoff / 2 + std::chrono::milliseconds(jitter(random));
+	}
+
+	auto batch::release_delayed() -> void {
+		auto now = std::chrono::steady_clock::now();
+		auto due = std::stable_partition(m_delayed.begin(), m_delayed.end(),
+			[now](const transfer& item) { return item.ready > now; });
+		for (auto it = due; it != m_delayed.end(); ++it) {
+			it->ready = {};
+			m_pending.push_front(std::move(*it));
+		}
+		m_delayed.erase(due, m_delayed.end());
+	}
+
+	auto batch::resume_paused() -> int {
+		auto now = std::chrono::steady_clock::now();
+		auto wait = std::chrono::steady_clock::duration{std::chrono::milliseconds(100)};
+		for (auto& item : m_running) {
+			auto paused = item.second.request->resume(now);
+			if (paused > std::chrono::steady_clock::duration::zero()) {
+				wait = std::min(wait, paused);
+			}
+		}
+		for (auto& item : m_delayed) {
+			wait = std::min(wait, std::max(item.ready - now, std::chrono::steady_clock::duration::zero()));
+		}
+		return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wait).count());
+	}
+
+	auto batch::replay_next() -> void {
+		auto next = std::min_element(m_running.begin(), m_running.end(),
+			[](const std::pair<CURL * const, transfer>& left, const std::pair<CURL * const, transfer>& right) {
+				return left.second.ready < right.second.ready;
+			});
+		std::this_thread::sleep_until(next->second.ready);
+		auto curl = next->first;
+		auto result = m_player->serve(*next->second.request, next->second.recorded);
+		finish(curl, result);
+	}
+
+	auto batch::run() -> void {
+		start_pending();
+		while (not m_running.empty() || not m_delayed.empty()) {
+			if (m_running.empty()) {
+				// only retries are left, nothing to do until the first is due
+				auto next = std::min_element(m_delayed.begin(), m_delayed.end(),
+					[](const transfer& left, const transfer& right) { return left.ready < right.ready; });
+				std::this_thread::sleep_until(next->ready);
+				release_delayed();
+				start_pending();
+				continue;
+			}
+			if (m_player != nullptr) {
+				replay_next();
+				release_delayed();
+				start_pending();
+				continue;
+			}
+
+			int running = 0;
+			curl_multi_perform(m_multi, &running);
+
+			CURLMsg * message = nullptr;
+			int left = 0;
+			while ((message = curl_multi_info_read(m_multi, &left)) != nullptr) {
+				if (message->msg != CURLMSG_DONE) continue;
+
+				CURL * curl = message->easy_handle;
+				CURLcode result = message->data.result;
+				curl_multi_remove_handle(m_multi, curl);
+				finish(curl, result);
+			}
+
+			release_delayed();
+			start_pending();
+			if (not m_running.empty()) {
+				curl_multi_wait(m_multi, nullptr, 0, resume_paused(), nullptr);
+			}
+		}
+	}
+}
+}
@@ -0,0 +1,125 @@
+#ifndef __BATCH_HPP__
+#define __BATCH_HPP__
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "context.hpp"
+#include "request.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief performs many requests concurrently on one multi handle of
+    ///     the calling thread, at most parallelism at a time. Connections
+    ///     are reused between the requests of the batch, dns and tls
+    ///     sessions through the share handle of context. Completions may
+    ///     add more requests to the same batch.
+    ///
+    /// The number of requests in flight adapts to latency and throttling of
+    /// the api, parallelism is only its upper bound. The adaptive limit
+    /// belongs to the host and is shared with the other batches of the
+    /// context, but a batch always has one request in flight. Requests answered with
+    /// 429 or 503 are sent again a few times, unless they stream a body:
+    /// after the delay of Retry-After, or after a backoff that doubles with
+    /// every attempt and is spread with jitter so retries do not come back
+    /// together.
+    ///
+    /// When the context replays a transcript, requests are not sent: each
+    /// completes after its recorded duration, concurrently with the others.
+    ///
+    /// Requests start only when a connection of their priority class is free.
+    /// A request held back by the rate or the share of its account does not
+    /// hold back the requests of other accounts.
+    /// A transfer over the bandwidth cap of its class is paused on its own,
+    /// the other transfers of the batch go on meanwhile.
+    ///
+    class batch
+    {
+    public:
+
+        using completion_t = std::function<void(CURLcode, request&)>;
+
+        ///
+        /// \param adaptive false keeps parallelism requests in flight from
+        ///     the start regardless of the limit of the host, e.g. to open
+        ///     that many connections at once
+        ///
+        batch(context& context, std::size_t parallelism, bool adaptive = true);
+
+        batch(const batch&) = delete;
+
+        auto operator=(const batch&) -> batch& = delete;
+
+        ~batch();
+
+        auto add(std::unique_ptr<request> request, completion_t on_done) -> void;
+
+        ///
+        /// \brief returns when all requests, including the ones added by
+        ///     completions, are done.
+        ///
+        auto run() -> void;
+
+    private:
+
+        struct transfer
+        {
+            std::unique_ptr<detail::request> request;
+            completion_t on_done;
+            std::size_t attempts;
+            std::uint64_t started;
+            const exchange * recorded;
+            std::chrono::steady_clock::time_point ready;
+            // host whose slot the transfer holds, empty if none
+            std::string host;
+        };
+
+        auto start_pending() -> void;
+
+        auto replay_next() -> void;
+
+        ///
+        /// \brief resumes transfers whose bandwidth pause is over.
+        /// \return milliseconds to wait for the sockets before the next one
+        ///
+        auto resume_paused() -> int;
+
+        ///
+        /// \brief moves retries whose delay is over to the front of the
+        ///     pending requests.
+        ///
+        auto release_delayed() -> void;
+
+        ///
+        /// \return delay before the next attempt of item, or a negative
+        ///     duration when it should not be sent again
+        ///
+        auto retry_delay(CURL * curl, const transfer& item) -> std::chrono::steady_clock::duration;
+
+        auto finish(CURL * curl, CURLcode result) -> void;
+
+        context& m_context;
+        std::size_t m_parallelism;
+        bool m_adaptive;
+        std::shared_ptr<recorder> m_recorder;
+        std::shared_ptr<player> m_player;
+        CURLM * m_multi;
+        std::deque<transfer> m_pending;
+        // retries waiting for their delay, in no particular order
+        std::vector<transfer> m_delayed;
+        std::map<CURL *, transfer> m_running;
+    };
+}
+}
+
+#endif // __BATCH_HPP__
@@ -0,0 +1,232 @@
+#include <yadisk/blob_cache.hpp>
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace yadisk
+{
+	// Hashes content on its way to downstream.
+	class sha256_sink : public sink
+	{
+	public:
+
+		explicit sha256_sink(sink& downstream) : m_downstream(downstream), m_context{EVP_MD_CTX_create()} {
+			if (m_context == nullptr || EVP_DigestInit_ex(m_context, EVP_sha256(), nullptr) != 1) {
+				EVP_MD_CTX_destroy(m_context);
+				throw std::runtime_error("EVP_DigestInit_ex");
+			}
+		}
+
+		~sha256_sink() {
+			EVP_MD_CTX_destroy(m_context);
+		}
+
+		auto reserve(std::uint64_t size) -> void override {
+			m_downstream.reserve(size);
+		}
+
+		auto write(const char * data, std::size_t size) -> bool override {
+			return EVP_DigestUpdate(m_context, data, size) == 1 && m_downstream.write(data, size);
+		}
+
+		auto close() -> bool override {
+			return m_downstream.close();
+		}
+
+		auto hex() -> std::string {
+			unsigned char digest[EVP_MAX_MD_SIZE];
+			unsigned int length = 0;
+			EVP_DigestFinal_ex(m_context, digest, &length);
+			static const char digits[] = "0123456789abcdef";
+			std::string text;
+			for (unsigned int i = 0; i < length; ++i) {
+				text.push_back(digits[digest[i] >> 4]);
+				text.push_back(digits[digest[i] & 0x0f]);
+			}
+			return text;
+		}
+
+	private:
+
+		sink& m_downstream;
+		EVP_MD_CTX * m_context;
+	};
+
+	static auto is_sha256(const std::string& text) -> bool {
+		if (text.size() != 64) return false;
+		for (auto symbol : text) {
+			if (not std::isxdigit(static_cast<unsigned char>(symbol))) return false;
+		}
+		return true;
+	}
+
+	static auto lower(std::string text) -> std::string {
+		std::transform(text.begin(), text.end(), text.begin(), [](char symbol) {
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(symbol)));
+		});
+		return text;
+	}
+
+	// reflink on file systems which support it, so the download does not
+	// share blocks the cache may later remove or modify
+	static auto clone(const fs::path& from, const fs::path& to) -> bool {
+#if defined(__linux__) && defined(FICLONE)
+		int source = ::open(from.string().c_str(), O_RDONLY);
+		if (source < 0) return false;
+		int target = ::open(to.string().c_str(), O_WRONLY | O_CREAT | O_EXCL, 0444);
+		if (target < 0) {
+			::close(source);
+			return false;
+		}
+		auto cloned = ::ioctl(target, FICLONE, source) == 0;
+		::close(target);
+		::close(source);
+		if (not cloned) {
+			boost::system::error_code error;
+			fs::remove(to, error);
+		}
+		return cloned;
+#else
+		return false;
+#endif
+	}
+
+	static auto link_or_copy(const fs::path& from, const fs::path& to) -> bool {
+		boost::system::error_code error;
+		fs::remove(to, error);
+		if (clone(from, to)) return true;
+
+		fs::create_hard_link(from, to, error);
+		if (not error) return true;
+
+		// a copy is private to the download, it does not stay read only
+		fs::copy_file(from, to, fs::copy_option::overwrite_if_exists, error);
+		if (error) return false;
+		fs::permissions(to, fs::add_perms | fs::owner_write, error);
+		return true;
+	}
+
+	BlobCache::BlobCache(fs::path directory, std::uint64_t capacity)
+		: m_directory{directory}, m_capacity{capacity} {}
+
+	auto BlobCache::blob_path(const string& sha256) const -> fs::path {
+		return m_directory / sha256.substr(0, 2) / sha256;
+	}
+
+	auto BlobCache::find(const string& sha256) const -> fs::path {
+		if (not is_sha256(sha256)) return {};
+
+		auto path = blob_path(lower(sha256));
+		boost::system::error_code error;
+		if (not fs::is_regular_file(path, error)) return {};
+		// modification time of a blob is its last use, for eviction
+		fs::last_write_time(path, std::time(nullptr), error);
+		return path;
+	}
+
+	auto BlobCache::download(Client& client, url::path from, fs::path to) -> json {
+
+		try {
+			json options;
+			options["fields"] = "name,path,size,sha256,md5";
+			auto meta = client.try_info(from, options);
+			if (not meta) {
+				return meta.error().code == errc::api ? meta.error().details : json();
+			}
+			auto sha256 = meta.value().find("sha256");
+			if (sha256 == meta.value().end() || not sha256->is_string() || not is_sha256(sha256->get<std::string>())) {
+				return json();
+			}
+			auto hash = lower(sha256->get<std::string>());
+
+			// a hit evicted by another process meanwhile is downloaded again
+			auto cached = find(hash);
+			if (not cached.empty() && link_or_copy(cached, to)) {
+				return meta.value();
+			}
+
+			cached = blob_path(hash);
+			fs::create_directories(cached.parent_path());
+			// a unique name, as other processes may fetch the same blob
+			auto part = cached.parent_path() / fs::unique_path("%%%%%%%%%%%%.part");
+			{
+				file_sink file{part};
+				sha256_sink hashing{file};
+				if (not client.try_download(from, hashing) || hashing.hex() != hash) {
+					file.close();
+					fs::remove(part);
+					return json();
+				}
+			}
+			fs::permissions(part, fs::owner_read | fs::group_read | fs::others_read);
+			// the download is linked while the file is private to this call,
+			// so neither eviction nor other processes can take it away first
+			if (not link_or_copy(part, to)) {
+				fs::remove(part);
+				return json();
+			}
+			fs::rename(part, cached);
+			evict(cached);
+			return meta.value();
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	auto BlobCache::size() const -> std::uint64_t {
+		std::uint64_t total = 0;
+		boost::system::error_code error;
+		for (fs::recursive_directory_iterator it{m_directory, error}, end; not error && it != end; it.increment(error)) {
+			if (fs::is_regular_file(it->status())) {
+				total += fs::file_size(it->path(), error);
+			}
+		}
+		return total;
+	}
+
+	auto BlobCache::evict() -> void {
+		evict(fs::path{});
+	}
+
+	auto BlobCache::evict(const fs::path& keep) -> void {
+		struct blob
+		{
+			fs::path path;
+			std::time_t used;
+			std::uint64_t size;
+		};
+		std::vector<blob> blobs;
+		std::uint64_t total = 0;
+		boost::system::error_code error;
+		for (fs::recursive_directory_iterator it{m_directory, error}, end; not error && it != end; it.increment(error)) {
+			if (not fs::is_regular_file(it->status()) || it->path().extension() == ".part") continue;
+			boost::system::error_code ignored;
+			blob item{it->path(), fs::last_write_time(it->path(), ignored), fs::file_size(it->path(), ignored)};
+			total += item.size;
+			blobs.push_back(item);
+		}
+
+		std::sort(blobs.begin(), blobs.end(), [](const blob& left, const blob& right) { return left.used < right.used; });
+		for (auto& item : blobs) {
+			if (total <= m_capacity) break;
+			// the blob just used counts, but stays
+			if (item.path == keep) continue;
+			// downloads linked to the blob keep their copy
+			fs::remove(item.path, error);
+			if (not error) total -= item.size;
+		}
+	}
+}
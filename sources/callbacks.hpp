@@ -1,3 +1,11 @@
+#ifndef __CALLBACKS_HPP__
+#define __CALLBACKS_HPP__
+
+#include <curl/curl.h>
+
+#include <yadisk/sink.hpp>
+#include <yadisk/source.hpp>
+
 template <class Stream>
 auto read(char * ptr, size_t size, size_t count, void * userdata) -> size_t {
 
@@ -15,3 +23,37 @@ auto write(char * ptr, size_t size, size_t count, void * userdata) -> size_t {
     stream->write(ptr, byte_count);
     return stream->fail() ? 0 : byte_count;
 }
+
+struct SinkTarget
+{
+    CURL * curl;
+    yadisk::sink * sink;
+    bool reserved;
+};
+
+inline auto write_sink(char * ptr, size_t size, size_t count, void * userdata) -> size_t {
+
+    auto target = reinterpret_cast<SinkTarget *>(userdata);
+    auto byte_count = count * size;
+    if (!target->reserved) {
+        target->reserved = true;
+#if LIBCURL_VERSION_NUM >= 0x073700
+        curl_off_t length = -1;
+        curl_easy_getinfo(target->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+#else
+        double length = -1;
+        curl_easy_getinfo(target->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length);
+#endif
+        if (length > 0) target->sink->reserve(static_cast<std::uint64_t>(length));
+    }
+    return target->sink->write(ptr, byte_count) ? byte_count : 0;
+}
+
+inline auto read_source(char * ptr, size_t size, size_t count, void * userdata) -> size_t {
+
+    auto source = reinterpret_cast<yadisk::source *>(userdata);
+    auto byte_count = source->read(ptr, count * size);
+    return byte_count == yadisk::source::abort ? CURL_READFUNC_ABORT : byte_count;
+}
+
+#endif // __CALLBACKS_HPP__
@@ -4,12 +4,20 @@
 #include <yadisk/client.hpp>
 #include <boost/algorithm/string/join.hpp>
 
+#include <algorithm>
+#include <deque>
 #include <sstream>
+#include <limits>
+#include <map>
 #include <set>
+#include <thread>
 using std::stringstream;
 
 #include "callbacks.hpp"
+#include "batch.hpp"
+#include "context.hpp"
 #include "quote.hpp"
+#include "request.hpp"
 #include "wrappers.hpp"
 
 static void parse_path (url::params_t& url_params, const std::string& resource, CURL * curl) {
@@ -106,9 +114,50 @@ static void parse_preview_crop (url::params_t& url_params, const json& options)
 	}
 }
 
-static url::params_t parse_params_for_info (const std::string& resource, const json& options, CURL * curl) {
+static void parse_media_type (url::params_t& url_params, const json& options) {
+	if (options.find("media_type") != options.end())
+	{
+		if (options["media_type"].is_string())
+		{
+			url_params["media_type"] = options["media_type"].get<std::string>();
+		}
+	}
+}
+
+static url::params_t parse_params_for_files (const json& options) {
+	url::params_t url_params;
+	parse_sort (url_params, options);
+	parse_limit (url_params, options);
+	parse_offset (url_params, options);
+	parse_fields (url_params, options);
+	parse_media_type (url_params, options);
+	parse_preview_size (url_params, options);
+	parse_preview_crop (url_params, options);
+	return url_params;
+}
+
+static url::params_t parse_options_for_info (const json& options) {
 	url::params_t url_params;
+	parse_sort (url_params, options);
+	parse_limit (url_params, options);
+	parse_offset (url_params, options);
+	parse_fields (url_params, options);
+	parse_preview_size (url_params, options);
+	parse_preview_crop (url_params, options);
+	return url_params;
+}
+
+static url::params_t parse_params_for_info (const std::string& resource, const json& options, CURL * curl) {
+	auto url_params = parse_options_for_info (options);
 	parse_path (url_params, resource, curl);
+	return url_params;
+}
+
+static url::params_t parse_params_for_public_info (const std::string& public_key,
+        const std::string& resource, const json& options, CURL * curl) {
+	url::params_t url_params;
+	url_params["public_key"] = escape(public_key, curl);
+	if (not resource.empty()) parse_path (url_params, resource, curl);
 	parse_sort (url_params, options);
 	parse_limit (url_params, options);
 	parse_offset (url_params, options);
@@ -133,185 +182,1250 @@ static std::string is_resource_in_trash(const json& options) {
 	return trash;
 }
 
-static std::stringstream perform_request (CURL * curl,
-        const char* url, curl_slist * header_list,
-        const char* type = "GET", int ssl_verify_host = 0,
-        int ssl_verify_peer = 0) {
-	stringstream response;
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, type);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write<stringstream>);
-	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, ssl_verify_host);
-	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, ssl_verify_peer);
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
-
-	auto response_code = curl_easy_perform(curl);
+static yadisk::result<json> transport_error (CURLcode code) {
+	yadisk::error_t error;
+	error.code = yadisk::errc::transport;
+	error.transport = code;
+	return error;
+}
+
+// Turns a finished exchange into a result: error statuses of the api carry
+// the name of the error and the body, the json body otherwise.
+static yadisk::result<json> make_result (CURLcode code, long http_code, const std::string& body) {
+	if (code != CURLE_OK) {
+		return transport_error(code);
+	}
+
+	json data;
+	if (not body.empty()) {
+		// the only exception left on the path, thrown for a malformed body
+		try {
+			data = json::parse(body);
+		}
+		catch(...) {
+			yadisk::error_t error;
+			error.code = yadisk::errc::parse;
+			error.http_code = http_code;
+			return error;
+		}
+	}
+
+	if (http_code >= 400) {
+		yadisk::error_t error;
+		error.code = yadisk::errc::api;
+		error.http_code = http_code;
+		if (data.is_object() && data.find("error") != data.end() && data["error"].is_string()) {
+			error.name = data["error"].get<std::string>();
+		}
+		error.details = std::move(data);
+		return error;
+	}
+	return data;
+}
+
+// Result of a request performed by context or by a batch.
+static yadisk::result<json> response_result (CURLcode code, yadisk::detail::request& request) {
+	auto http_code = code == CURLE_OK ? request.http_code() : 0;
+	return make_result(code, http_code, request.response().str());
+}
 
+static yadisk::result<json> perform_request (yadisk::detail::context& context,
+        yadisk::detail::request& request) {
+	return response_result(context.perform(request), request);
+}
+
+// Performs an idempotent GET, sharing it with identical requests of the same
+// user which are in flight at the moment; the key includes the
+// authorization header, so different tokens never share a response. A
+// request with a deadline or a cancellation is performed on its own: waiting
+// for another caller's request would neither honour its limits nor survive
+// the other caller giving up.
+static yadisk::detail::single_flight::result_ptr share_request (yadisk::detail::context& context,
+        yadisk::detail::request& request, const std::string& auth_header) {
+	auto call = [&context, &request]() {
+		yadisk::detail::single_flight::result result;
+		result.code = context.perform(request);
+		result.http_code = result.code == CURLE_OK ? request.http_code() : 0;
+		result.body = request.response().str();
+		return result;
+	};
+	if (request.cancellable() || request.deadline() != std::chrono::steady_clock::time_point::max()) {
+		return std::make_shared<const yadisk::detail::single_flight::result>(call());
+	}
+	auto key = request.method() + " " + request.url() + "\n" + auth_header;
+	return context.flights.run(key, call);
+}
+
+static yadisk::result<json> perform_shared_request (yadisk::detail::context& context,
+        yadisk::detail::request& request, const std::string& auth_header) {
+	auto result = share_request(context, request, auth_header);
+	return make_result(result->code, result->http_code, result->body);
+}
+
+// Same as perform_shared_request, a successful body is parsed into a
+// document; error bodies are small and stay plain json.
+static yadisk::result<yadisk::document> perform_shared_document_request (yadisk::detail::context& context,
+        yadisk::detail::request& request, const std::string& auth_header) {
+	auto result = share_request(context, request, auth_header);
+	if (result->code != CURLE_OK || result->http_code >= 400) {
+		return make_result(result->code, result->http_code, result->body).error();
+	}
+	try {
+		return yadisk::document::parse(result->body.empty() ? "null" : result->body);
+	}
+	catch(...) {
+		yadisk::error_t error;
+		error.code = yadisk::errc::parse;
+		error.http_code = result->http_code;
+		return error;
+	}
+}
+
+// Performs a transfer to a sink or from a source; the body is streamed,
+// so only the status is checked.
+static yadisk::result<json> perform_transfer (yadisk::detail::context& context,
+        yadisk::detail::request& request, std::initializer_list<long> expected) {
+	auto response_code = context.perform(request);
 	if (response_code != CURLE_OK) {
-		throw std::runtime_error("curl_easy_perform");
+		return transport_error(response_code);
+	}
+	auto http_code = request.http_code();
+	for (auto code : expected) {
+		if (http_code == code) return json();
+	}
+	yadisk::error_t error;
+	error.code = yadisk::errc::api;
+	error.http_code = http_code;
+	return error;
+}
+
+// The call could not be made, e.g. options could not be turned into a url.
+static yadisk::result<json> invalid_call () {
+	yadisk::error_t error;
+	error.code = yadisk::errc::invalid;
+	return error;
+}
+
+// Legacy form of a result for the json returning methods: the value, the
+// api error as returned by the api or empty json() on other failures.
+static json value_or_details (const yadisk::result<json>& result) {
+	if (result) {
+		return result.value();
+	}
+	return result.error().code == yadisk::errc::api ? result.error().details : json();
+}
+
+static std::string strip_disk_prefix(const std::string& resource) {
+	static const std::string prefix = "disk:";
+	return resource.compare(0, prefix.size(), prefix) == 0 ? resource.substr(prefix.size()) : resource;
+}
+
+// Result of a page of a directory listing. Its items are checked to be
+// objects with a string type and path, so they can be read as they are; a
+// page with any malformed item is a parse error as a whole.
+static yadisk::result<json> listing_result (CURLcode code, yadisk::detail::request& request) {
+	auto response = response_result(code, request);
+	if (not response) return response;
+
+	auto& meta = response.value();
+	auto embedded = meta.find("_embedded");
+	auto valid = embedded != meta.end() && embedded->is_object();
+	if (valid) {
+		auto items = embedded->find("items");
+		auto limit = embedded->find("limit");
+		auto total = embedded->find("total");
+		valid = items != embedded->end() && items->is_array()
+			&& limit != embedded->end() && limit->is_number_integer()
+			&& total != embedded->end() && total->is_number_integer()
+			&& std::all_of(items->begin(), items->end(), [](const json& item) {
+				auto type = item.find("type");
+				auto path = item.find("path");
+				return item.is_object() && type != item.end() && type->is_string()
+					&& path != item.end() && path->is_string();
+			});
+	}
+	if (not valid) {
+		yadisk::error_t error;
+		error.code = yadisk::errc::parse;
+		error.http_code = request.http_code();
+		return error;
 	}
 	return response;
 }
 
+// Lists directories page by page on a batch, descending into the
+// subdirectories the visitor asks for. Directories whose listing failed
+// are collected in failed.
+struct walker
+{
+	using make_request_t = std::function<std::unique_ptr<yadisk::detail::request>(const std::string& directory, const json& options)>;
+	using visit_t = std::function<bool(const json& item)>;
+
+	yadisk::detail::batch& batch;
+	make_request_t make_request;
+	visit_t visit;
+	std::vector<std::string> failed;
+
+	void list(std::string directory, int offset = 0) {
+		json options;
+		options["limit"] = 1000;
+		options["offset"] = offset;
+		batch.add(make_request(directory, options), [this, directory, offset](CURLcode code, yadisk::detail::request& request) {
+			auto response = listing_result(code, request);
+			if (not response) {
+				failed.push_back(directory);
+				return;
+			}
+			auto embedded = response.value().find("_embedded");
+			for (auto& item : (*embedded)["items"]) {
+				if (visit(item) && item["type"].get<std::string>() == "dir") {
+					list(strip_disk_prefix(item["path"].get<std::string>()));
+				}
+			}
+			auto limit = (*embedded)["limit"].get<int>();
+			if (limit > 0 && offset + limit < (*embedded)["total"].get<int>()) {
+				list(directory, offset + limit);
+			}
+		});
+	}
+};
+
 namespace yadisk
 {
 	static const std::string api_url = "https://cloud-api.yandex.net/v1/disk";
+	// the token is kept with the header prefix, so requests copy the header
+	// instead of building it; an array, as clients may be constructed
+	// during static initialization
+	static const char auth_prefix[] = "Authorization: OAuth ";
 
-	Client::Client(string token_) : token{token_} {}
+	Client::Client(string token_)
+		: m_token{std::make_shared<const string>(auth_prefix + token_)},
+		  m_context{std::make_shared<detail::context>()} {}
 
-	auto Client::ping() -> bool {
+	auto Client::token() const -> string {
+		return std::atomic_load(&m_token)->substr(sizeof(auth_prefix) - 1);
+	}
 
-		CURL * curl = curl_easy_init();
-		if (curl == nullptr) return false;
+	auto Client::set_token(string token_) -> void {
+		std::atomic_store(&m_token, std::make_shared<const string>(auth_prefix + token_));
+	}
 
-		std::string url = api_url;
+	auto Client::stats() const -> stats_t {
+		stats_t stats;
+		stats.requests = m_context->requests.load(std::memory_order_relaxed);
+		stats.failures = m_context->failures.load(std::memory_order_relaxed);
+		stats.bytes_sent = m_context->bytes_sent.load(std::memory_order_relaxed);
+		stats.bytes_received = m_context->bytes_received.load(std::memory_order_relaxed);
+		stats.coalesced = m_context->flights.coalesced();
+		stats.hedged = m_context->hedged.load(std::memory_order_relaxed);
+		return stats;
+	}
 
-		struct curl_slist *header_list = nullptr;
-		std::string auth_header = "Authorization: OAuth " + token;
-		header_list = curl_slist_append(header_list, auth_header.c_str());
+	auto Client::set_limits(priority level, limits_t limits) -> void {
+		m_context->lanes.set_limits(level, limits.connections, limits.send_rate, limits.receive_rate);
+	}
 
-		curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-		curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
-		curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+	auto Client::set_bandwidth(std::uint64_t send_rate, std::uint64_t receive_rate) -> void {
+		m_context->lanes.set_bandwidth(send_rate, receive_rate);
+	}
 
-		auto response_code = curl_easy_perform(curl);
-		
-		long http_response_code = 0;
-		if (response_code == CURLE_OK) {
-			response_code = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_response_code);			
-		}	
-		
-		curl_slist_free_all(header_list);
-		curl_easy_cleanup(curl);
+	auto Client::record(fs::path transcript) -> bool {
+		try {
+			m_context->set_recorder(std::make_shared<detail::recorder>(transcript));
+			return true;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
 
-		if (response_code != CURLE_OK) return false;
+	auto Client::stop_recording() -> void {
+		m_context->set_recorder(nullptr);
+	}
 
-		return http_response_code == 200;
+	auto Client::replay(fs::path transcript, double time_scale) -> bool {
+		try {
+			m_context->set_player(std::make_shared<detail::player>(transcript, time_scale));
+			return true;
+		}
+		catch (const std::exception&) {
+			return false;
+		}
 	}
 
-	auto Client::info(url::path resource, json options/*= nullptr*/) -> json {
+	auto Client::stop_replaying() -> void {
+		m_context->set_player(nullptr);
+	}
+
+	auto Client::set_priority(priority level) -> void {
+		m_priority = level;
+	}
+
+	auto Client::set_deadline(std::chrono::steady_clock::time_point deadline) -> void {
+		m_deadline = deadline;
+	}
+
+	auto Client::set_timeout(std::chrono::milliseconds timeout) -> void {
+		m_timeout = timeout;
+	}
+
+	auto Client::set_cancellation(cancellation token) -> void {
+		m_cancelled = token.state();
+	}
+
+	auto Client::set_stall_timeout(std::chrono::seconds timeout) -> void {
+		m_stall_timeout = timeout;
+	}
+
+	auto Client::set_hedging(double percentile, double budget) -> void {
+		m_hedge_percentile = percentile;
+		m_hedge_budget = budget;
+	}
+
+	auto Client::get_priority() const -> priority {
+		return m_priority;
+	}
+
+	auto Client::auth_header() const -> string {
+		return *std::atomic_load(&m_token);
+	}
+
+	auto Client::new_request(string method) const -> std::unique_ptr<detail::request> {
+		std::unique_ptr<detail::request> request{new detail::request{method}};
+		request->set_priority(m_priority);
+		request->set_tenant(m_tenant);
+		auto deadline = m_deadline;
+		if (m_timeout.count() > 0) {
+			deadline = std::min(deadline, std::chrono::steady_clock::now() + m_timeout);
+		}
+		request->set_deadline(deadline);
+		request->set_cancellation(m_cancelled);
+		request->set_stall_timeout(static_cast<long>(m_stall_timeout.count()));
+		request->set_hedging(m_hedge_percentile, m_hedge_budget);
+		return request;
+	}
+
+	auto Client::ping_request() const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
+		request->set_url(api_url);
+		request->add_header(auth_header());
+		request->set_nobody();
+		return request;
+	}
+
+	// the api root answers without a token, probes do not depend on it
+	static auto probe_request(priority level) -> std::unique_ptr<detail::request> {
+		std::unique_ptr<detail::request> request{new detail::request{"GET"}};
+		request->set_priority(level);
+		request->set_url(api_url);
+		request->set_nobody();
+		return request;
+	}
+
+	auto initialize() -> bool {
+		return detail::global_init() == CURLE_OK;
+	}
+
+	auto Client::warmup(std::size_t connections) -> std::future<std::size_t> {
+		std::promise<std::size_t> promise;
+		auto established = promise.get_future();
+		auto context = m_context;
+		auto level = m_priority;
+		std::thread{[context, connections, level](std::promise<std::size_t> promise) {
+			std::size_t count = 0;
+			try {
+				// concurrent transfers cannot share a connection, so each one
+				// opens its own and leaves its tls session in the share handle;
+				// all probes start at once, without the slow start of batches
+				detail::batch batch{*context, connections, false};
+				for (std::size_t i = 0; i < connections; ++i) {
+					batch.add(probe_request(level), [&count](CURLcode code, detail::request& request) {
+						if (code != CURLE_OK) return;
+						long opened = 0;
+						curl_easy_getinfo(request.handle(), CURLINFO_NUM_CONNECTS, &opened);
+						count += static_cast<std::size_t>(opened);
+					});
+				}
+				batch.run();
+			}
+			catch (...) {}
+			promise.set_value(count);
+		}, std::move(promise)}.detach();
+		return established;
+	}
+
+	auto Client::keep_alive(std::chrono::seconds interval) -> void {
+		auto level = m_priority;
+		m_context->keep_alive(interval, [level]() { return probe_request(level); });
+	}
+
+	auto Client::healthy() const -> bool {
+		return m_context->healthy();
+	}
+
+	auto Client::ping() -> bool {
+
 		try {
-			return info_impl(resource, options);
+			auto request = ping_request();
+			auto response_code = m_context->perform(*request);
+
+			if (response_code != CURLE_OK) return false;
+
+			return request->http_code() == 200;
 		}
 		catch(...) {
-			return json();
+			return false;
 		}
 	}
 
-	auto Client::info_impl (url::path resource, json options) -> json {
-		CurlWrapper curl_wrapper;
+	auto Client::info(url::path resource, json options/*= nullptr*/) -> json {
+		return value_or_details(try_info(resource, options));
+	}
+
+	auto Client::info_request(url::path resource, json options) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
 
-		auto url_params = parse_params_for_info(resource.string(), options, curl_wrapper.getCurl());
+		auto url_params = parse_params_for_info(resource.string(), options, request->handle());
 
 		auto trash = is_resource_in_trash(options);
-		std::string url = api_url + trash + "/resources" + "?" + url_params.string();
+		request->set_url(api_url + trash + "/resources" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
+
+	auto Client::prepare_info(json options) const -> prepared_info {
+		prepared_info prepared;
+		auto url_params = parse_options_for_info(options);
+		// path goes last, so a call only appends it to the compiled url
+		prepared.m_prefix = api_url + is_resource_in_trash(options) + "/resources" + "?" + url_params.string() + "path=";
+		return prepared;
+	}
 
-		std::string auth_header = "Authorization: OAuth " + token;
-		CurlSlistWrapper header_list {auth_header.c_str()};
+	auto Client::info(const prepared_info& prepared, url::path resource) -> json {
+		return value_or_details(try_info(prepared, resource));
+	}
 
-		auto response = perform_request (curl_wrapper.getCurl(), url.c_str(),
-			header_list.getCurlSlist());
-		auto response_data = json::parse (response);
+	auto Client::try_info(const prepared_info& prepared, url::path resource) -> result<json> {
 
-		return response_data;
+		try {
+			auto request = new_request("GET");
+			request->set_url(prepared.m_prefix + quote(resource.string(), request->handle()));
+			auto auth = auth_header();
+			request->add_header(auth);
+			return perform_shared_request (*m_context, *request, auth);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::try_info(url::path resource, json options) -> result<json> {
+		try {
+			auto request = info_request(resource, options);
+			return perform_shared_request (*m_context, *request, auth_header());
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::try_info_document(url::path resource, json options) -> result<document> {
+		try {
+			auto request = info_request(resource, options);
+			return perform_shared_document_request (*m_context, *request, auth_header());
+		}
+		catch(...) {
+			return invalid_call().error();
+		}
+	}
+
+	auto Client::copy_request(url::path from, url::path to, bool overwrite, std::list<string> fields) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("POST");
+
+		url::params_t url_params;
+		url_params["from"] = quote(from.string(), request->handle());
+		url_params["path"] = quote(to.string(), request->handle());
+		url_params["overwrite"] = overwrite ? "true" : "false";
+		url_params["fields"] = boost::algorithm::join(fields, ",");
+		request->set_url(api_url + "/resources/copy" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
 	}
 
 	auto Client::copy(url::path from, url::path to, bool overwrite, std::list<std::string> fields) -> json {
+		return value_or_details(try_copy(from, to, overwrite, fields));
+	}
+
+	auto Client::try_copy(url::path from, url::path to, bool overwrite, std::list<string> fields) -> result<json> {
+
+		try {
+			auto request = copy_request(from, to, overwrite, fields);
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
 
-		CURL * curl = curl_easy_init();
-		if (!curl) return json();
+	auto Client::download_link_request(url::path from) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
 
 		url::params_t url_params;
-		url_params["from"] = quote(from.string(), curl);
-		url_params["path"] = quote(to.string(), curl);
-		url_params["overwrite"] = overwrite;
+		url_params["path"] = quote(from.string(), request->handle());
+		request->set_url(api_url + "/resources/download" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
+
+	auto Client::fetch_request(string href, sink& to) const -> std::unique_ptr<detail::request> {
+		// download links are signed, they do not need the token
+		auto request = new_request("GET");
+		request->set_url(href);
+		request->set_sink(to);
+		return request;
+	}
+
+	auto Client::download(url::path from, sink& to) -> json {
+		return value_or_details(try_download(from, to));
+	}
+
+	auto Client::try_download_link(url::path from) -> result<json> {
+
+		try {
+			auto request = download_link_request(from);
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::try_download(url::path from, sink& to) -> result<json> {
+
+		try {
+			auto link = try_download_link(from);
+			if (not link || not link.value().is_object() || link.value().find("href") == link.value().end()) return link;
+
+			auto request = fetch_request(link.value()["href"].get<std::string>(), to);
+			auto fetched = perform_transfer (*m_context, *request, {200});
+			if (not fetched) return fetched;
+
+			// data kept by the sink fails to be stored as a failed write would
+			if (not to.close()) {
+				error_t error;
+				error.code = errc::transport;
+				error.transport = CURLE_WRITE_ERROR;
+				return error;
+			}
+			return link;
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::upload_link_request(url::path to, bool overwrite, std::list<string> fields) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
+
+		url::params_t url_params;
+		url_params["path"] = quote(to.string(), request->handle());
+		url_params["overwrite"] = overwrite ? "true" : "false";
 		url_params["fields"] = boost::algorithm::join(fields, ",");
-		std::string url = api_url + "/resources/copy" + "?" + url_params.string();
+		request->set_url(api_url + "/resources/upload" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
 
-		struct curl_slist *header_list = nullptr;
-		std::string auth_header = "Authorization: OAuth " + token;
-		header_list = curl_slist_append(header_list, auth_header.c_str());
+	auto Client::put_request(string href, source& from) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("PUT");
+		request->set_url(href);
+		request->set_source(from);
+		return request;
+	}
 
-		stringstream response;
-		curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-		curl_easy_setopt(curl, CURLOPT_READDATA, &response);
-		curl_easy_setopt(curl, CURLOPT_READFUNCTION, write<stringstream>);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+	auto Client::upload(url::path to, source& from, bool overwrite, std::list<string> fields) -> json {
+		return value_or_details(try_upload(to, from, overwrite, fields));
+	}
 
-		auto response_code = curl_easy_perform(curl);
+	auto Client::try_upload(url::path to, source& from, bool overwrite, std::list<string> fields) -> result<json> {
 
-		curl_slist_free_all(header_list);
-		curl_easy_cleanup(curl);
+		try {
+			auto link_request = upload_link_request(to, overwrite, fields);
+			auto link = perform_request (*m_context, *link_request);
+			if (not link || not link.value().is_object() || link.value().find("href") == link.value().end()) return link;
 
-		if (response_code != CURLE_OK) return json();
+			auto request = put_request(link.value()["href"].get<std::string>(), from);
+			auto stored = perform_transfer (*m_context, *request, {201, 202});
+			if (not stored) return stored;
 
-		auto response_data = json::parse(response);
-		return response_data;
+			return link;
+		}
+		catch(...) {
+			return invalid_call();
+		}
 	}
-    
-	auto Client::patch(url::path resource, json meta, std::list<string> fields) -> json {
 
+	auto Client::upload(url::path to, fs::path from, bool overwrite, std::list<string> fields) -> json {
+
+		try {
+			file_source source{from};
+			return upload(to, source, overwrite, fields);
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	auto Client::upload(url::path to, std::istream& from, bool overwrite, std::list<string> fields, std::size_t buffer_size) -> json {
+
+		stream_source upstream{from};
+		buffered_source source{upstream, buffer_size};
+		return upload(to, source, overwrite, fields);
+	}
+
+	auto Client::upload(url::path to, callback_source::callback_t producer, bool overwrite, std::list<string> fields, std::size_t buffer_size) -> json {
+
+		callback_source upstream{producer};
+		buffered_source source{upstream, buffer_size};
+		return upload(to, source, overwrite, fields);
+	}
+
+	auto Client::upload(std::vector<std::pair<fs::path, url::path>> files, bool overwrite,
+	                    std::size_t parallelism, std::size_t lookahead) -> json {
+
+		// an upload link lives for about half an hour, a transfer which
+		// waited longer in the batch is refused and asks for a new one
+		static const std::size_t max_attempts = 2;
+
+		try {
+			detail::batch batch{*m_context, parallelism};
+			json report;
+			report["uploaded"] = 0;
+			report["failed"] = json::array();
+
+			std::size_t next = 0;
+			std::size_t outstanding = 0;
+			std::function<void(std::size_t, std::size_t)> request_link;
+
+			auto done = [&](std::size_t index, bool uploaded) {
+				if (uploaded) {
+					report["uploaded"] = report["uploaded"].get<int>() + 1;
+				}
+				else {
+					report["failed"].push_back(files[index].second.string());
+				}
+				--outstanding;
+				while (outstanding < lookahead && next < files.size()) {
+					++outstanding;
+					request_link(next++, 1);
+				}
+			};
+
+			auto put = [&](std::size_t index, std::size_t attempt, std::string href) {
+				std::shared_ptr<file_source> source;
+				try {
+					source = std::make_shared<file_source>(files[index].first);
+				}
+				catch (...) {
+					done(index, false);
+					return;
+				}
+				batch.add(put_request(href, *source), [&, index, attempt, source](CURLcode code, detail::request& request) {
+					auto http_code = code == CURLE_OK ? request.http_code() : 0;
+					if ((http_code == 404 || http_code == 410) && attempt < max_attempts) {
+						request_link(index, attempt + 1);
+						return;
+					}
+					done(index, http_code == 201 || http_code == 202);
+				});
+			};
+
+			request_link = [&](std::size_t index, std::size_t attempt) {
+				auto link_request = upload_link_request(files[index].second, overwrite, {});
+				batch.add(std::move(link_request), [&, index, attempt](CURLcode code, detail::request& request) {
+					auto link = response_result(code, request);
+					if (not link || not link.value().is_object() || link.value().find("href") == link.value().end()) {
+						done(index, false);
+						return;
+					}
+					put(index, attempt, link.value()["href"].get<std::string>());
+				});
+			};
+
+			lookahead = std::max<std::size_t>(lookahead, 1);
+			while (outstanding < lookahead && next < files.size()) {
+				++outstanding;
+				request_link(next++, 1);
+			}
+			batch.run();
+			return report;
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	// Path of a directory as the cache of known directories keys it, "/a/b";
+	// empty for the root.
+	static auto directory_path(const url::path& dir) -> std::string {
+		auto path = dir.string();
+		if (path.compare(0, 5, "disk:") == 0) path.erase(0, 5);
+		while (not path.empty() && path.back() == '/') path.pop_back();
+		if (not path.empty() && path.front() != '/') path.insert(0, "/");
+		return path;
+	}
+
+	auto Client::forget_directory(url::path dir) -> void {
+		auto path = directory_path(dir);
+		// the root always exists, anything else below it may be gone
+		m_context->directories.forget(auth_header() + "\n" + path);
+	}
+
+	auto Client::move(url::path from, url::path to, bool overwrite, std::list<string> fields) -> json {
+		return value_or_details(try_move(from, to, overwrite, fields));
+	}
+
+	auto Client::try_move(url::path from, url::path to, bool overwrite, std::list<string> fields) -> result<json> {
+
+		try {
+			auto request = new_request("POST");
+
+			url::params_t url_params;
+			url_params["from"] = quote(from.string(), request->handle());
+			url_params["path"] = quote(to.string(), request->handle());
+			url_params["overwrite"] = overwrite ? "true" : "false";
+			url_params["fields"] = boost::algorithm::join(fields, ",");
+			request->set_url(api_url + "/resources/move" + "?" + url_params.string());
+			request->add_header(auth_header());
+
+			// known directories under both ends may change, even if the call fails
+			// halfway
+			forget_directory(from);
+			forget_directory(to);
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::remove(url::path resource, bool permanently, std::list<string> fields) -> json {
+		return value_or_details(try_remove(resource, permanently, fields));
+	}
+
+	auto Client::try_remove(url::path resource, bool permanently, std::list<string> fields) -> result<json> {
+
+		try {
+			auto request = new_request("DELETE");
+
+			url::params_t url_params;
+			url_params["path"] = quote(resource.string(), request->handle());
+			url_params["permanently"] = permanently ? "true" : "false";
+			url_params["fields"] = boost::algorithm::join(fields, ",");
+			request->set_url(api_url + "/resources" + "?" + url_params.string());
+			request->add_header(auth_header());
+
+			forget_directory(resource);
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::mkdir_request(url::path dir, std::list<string> fields) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("PUT");
+
+		url::params_t url_params;
+		url_params["fields"] = boost::algorithm::join(fields, ",");
+		url_params["path"] = quote(dir.string(), request->handle());
+		request->set_url(api_url + "/resources" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
+
+	auto Client::mkdir(url::path dir, std::list<string> fields) -> json {
+		return value_or_details(try_mkdir(dir, fields));
+	}
+
+	auto Client::try_mkdir(url::path dir, std::list<string> fields) -> result<json> {
+
+		try {
+			auto request = mkdir_request(dir, fields);
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::mkdir(std::vector<url::path> dirs, std::size_t parallelism) -> json {
+
+		// a directory removed since it was cached fails its children, they
+		// are planned once more without the cache
+		static const std::size_t max_attempts = 2;
+
+		try {
+			auto auth = auth_header();
+			auto key = [&auth](const std::string& dir) { return auth + "\n" + dir; };
+			auto parent = [](const std::string& dir) { return dir.substr(0, dir.rfind('/')); };
+
+			std::set<std::string> targets;
+			for (auto& dir : dirs) {
+				auto path = directory_path(dir);
+				if (not path.empty()) targets.insert(path);
+			}
+
+			json report;
+			report["created"] = 0;
+			report["existed"] = 0;
+			report["known"] = 0;
+			report["failed"] = json::array();
+
+			for (std::size_t attempt = 1; not targets.empty(); ++attempt) {
+				// each directory is planned once, below the nearest parent which
+				// is planned too; the rest start right away
+				std::map<std::string, std::vector<std::string>> children;
+				std::vector<std::string> ready;
+				std::set<std::string> planned;
+				for (auto& target : targets) {
+					std::string child;
+					for (auto current = target; ; current = parent(current)) {
+						if (current.empty() || (attempt == 1 && m_context->directories.contains(key(current)))) {
+							if (not child.empty()) {
+								ready.push_back(child);
+							}
+							else if (not current.empty()) {
+								report["known"] = report["known"].get<int>() + 1;
+							}
+							break;
+						}
+						if (planned.find(current) != planned.end()) {
+							if (not child.empty()) children[current].push_back(child);
+							break;
+						}
+						planned.insert(current);
+						if (not child.empty()) children[current].push_back(child);
+						child = current;
+					}
+				}
+
+				std::set<std::string> stale;
+				std::function<void(const std::string&, bool)> fail = [&](const std::string& dir, bool retry) {
+					if (targets.find(dir) != targets.end()) {
+						if (retry && attempt < max_attempts) {
+							stale.insert(dir);
+						}
+						else {
+							report["failed"].push_back(dir);
+						}
+					}
+					for (auto& child : children[dir]) {
+						fail(child, retry);
+					}
+				};
+
+				detail::batch batch{*m_context, parallelism};
+				std::function<void(const std::string&)> make = [&](const std::string& dir) {
+					batch.add(mkdir_request(dir, {}), [&, dir](CURLcode code, detail::request& request) {
+						auto answer = response_result(code, request);
+						auto exists = static_cast<bool>(answer);
+						if (exists) {
+							report["created"] = report["created"].get<int>() + 1;
+						}
+						else if (answer.error().name == "DiskPathPointsToExistentDirectoryError") {
+							report["existed"] = report["existed"].get<int>() + 1;
+							exists = true;
+						}
+						if (not exists) {
+							auto missing = answer.error().name == "DiskPathDoesntExistsError";
+							if (missing) {
+								m_context->directories.forget(key(parent(dir)));
+							}
+							fail(dir, missing);
+							return;
+						}
+						m_context->directories.insert(key(dir));
+						for (auto& child : children[dir]) {
+							make(child);
+						}
+					});
+				};
+				for (auto& dir : ready) {
+					make(dir);
+				}
+				batch.run();
+				targets.swap(stale);
+			}
+			return report;
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	auto Client::patch_request(url::path resource, json meta, std::list<string> fields) const -> std::unique_ptr<detail::request> {
 		// init http request
-		CURL * curl = curl_easy_init();
-		if (curl == nullptr) return json();
+		auto request = new_request("PATCH");
 
 		// fill http url
 		url::params_t url_params;
 		url_params["fields"] = boost::algorithm::join(fields, ",");
-		url_params["path"] = quote(resource.string(), curl);
-		std::string url = api_url + "/resources" + "?" + url_params.string();
+		url_params["path"] = quote(resource.string(), request->handle());
+		request->set_url(api_url + "/resources" + "?" + url_params.string());
 
 		// fill http headers
-		curl_slist * header_list = nullptr;
-		std::string auth_header = "Authorization: OAuth " + token;
-		header_list = curl_slist_append(header_list, "Content-Type: application/json");
-		header_list = curl_slist_append(header_list, auth_header.c_str());
+		request->add_header("Content-Type: application/json");
+		request->add_header(auth_header());
 
 		// fill http body
-		auto request_body = meta.dump();
-
-		// build http request
-		stringstream response_body;
-		curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-		curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-		curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
-		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write<stringstream>);
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request_body.c_str());
-		curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, request_body.size());
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
-		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
-		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
-
-		// perform http request
-		auto response_code = curl_easy_perform(curl);
-
-		// clean resources
-		curl_slist_free_all(header_list);
-		curl_easy_cleanup(curl);
-
-		// check response code
-		if ( response_code != CURLE_OK ) return json();
-
-		// handle body of http response
-		auto info = json::parse(response_body);
-		return info;
+		request->set_body(meta.dump());
+		return request;
 	}
-}
 
-class curl_environment {
-public:
-    curl_environment() {
-        curl_global_init(CURL_GLOBAL_ALL);
-    }
-    ~curl_environment() {
-        curl_global_cleanup();
-    }
-};
+	auto Client::patch(url::path resource, json meta, std::list<string> fields) -> json {
+		return value_or_details(try_patch(resource, meta, fields));
+	}
+
+	auto Client::try_patch(url::path resource, json meta, std::list<string> fields) -> result<json> {
+
+		try {
+			auto request = patch_request(resource, meta, fields);
+
+			// perform http request and handle body of http response
+			return perform_request (*m_context, *request);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
 
-static const curl_environment env;
+	auto Client::public_info_request(string public_key, url::path resource, json options) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
+
+		auto url_params = parse_params_for_public_info(public_key, resource.string(), options, request->handle());
+		request->set_url(api_url + "/public/resources" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
+
+	auto Client::info(string public_key, url::path resource, json options) -> json {
+		return value_or_details(try_info(public_key, resource, options));
+	}
+
+	auto Client::try_info(string public_key, url::path resource, json options) -> result<json> {
+
+		try {
+			auto request = public_info_request(public_key, resource, options);
+			return perform_shared_request (*m_context, *request, auth_header());
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::download(string public_key, fs::path to, url::path file) -> json {
+
+		try {
+			auto link_request = new_request("GET");
+			url::params_t url_params;
+			url_params["public_key"] = escape(public_key, link_request->handle());
+			if (not file.string().empty()) {
+				url_params["path"] = quote(file.string(), link_request->handle());
+			}
+			link_request->set_url(api_url + "/public/resources/download" + "?" + url_params.string());
+			link_request->add_header(auth_header());
+
+			auto link = perform_request (*m_context, *link_request);
+			if (not link || not link.value().is_object() || link.value().find("href") == link.value().end()) return value_or_details(link);
+
+			file_sink sink{to};
+			auto request = fetch_request(link.value()["href"].get<std::string>(), sink);
+			if (not perform_transfer (*m_context, *request, {200})) return json();
+
+			if (not sink.close()) return json();
+			return link.value();
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	auto Client::save(string public_key, string name, url::path file) -> json {
+
+		try {
+			auto request = new_request("POST");
+			url::params_t url_params;
+			url_params["public_key"] = escape(public_key, request->handle());
+			if (not file.string().empty()) {
+				url_params["path"] = quote(file.string(), request->handle());
+			}
+			if (not name.empty()) {
+				url_params["name"] = escape(name, request->handle());
+			}
+			request->set_url(api_url + "/public/resources/save-to-disk" + "?" + url_params.string());
+			request->add_header(auth_header());
+
+			return value_or_details(perform_request (*m_context, *request));
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	static auto local_path(const fs::path& root, const std::string& resource, fs::path& result) -> bool {
+		result = root;
+		for (auto& name : split(resource, url::path::separator)) {
+			if (name == "." || name == "..") return false;
+			result /= name;
+		}
+		return true;
+	}
+
+	auto Client::download_folder(string public_key, fs::path to, url::path folder,
+	                             std::size_t parallelism, std::size_t lookahead) -> json {
+
+		try {
+			detail::batch batch{*m_context, parallelism};
+			json report;
+			report["downloaded"] = 0;
+			report["failed"] = json::array();
+
+			// files found by the listings wait here, a file is opened only
+			// when it is among the lookahead ones in the batch
+			std::deque<std::pair<std::string, std::string>> found;
+			std::size_t outstanding = 0;
+			lookahead = std::max<std::size_t>(lookahead, 1);
+			std::function<void()> fetch_found;
+
+			std::function<bool(std::string, std::string)> fetch_file =
+				[&](std::string resource, std::string href) {
+				fs::path target;
+				if (not local_path(to, resource, target)) {
+					report["failed"].push_back(resource);
+					return false;
+				}
+				// a file which can not be created fails alone, the others go on
+				boost::system::error_code error;
+				fs::create_directories(target.parent_path(), error);
+				std::shared_ptr<file_sink> sink;
+				if (not error) {
+					try {
+						sink = std::make_shared<file_sink>(target);
+					}
+					catch (...) {}
+				}
+				if (sink == nullptr) {
+					report["failed"].push_back(resource);
+					return false;
+				}
+				batch.add(fetch_request(href, *sink), [&, sink, resource, target](CURLcode code, detail::request& request) {
+					auto closed = sink->close();
+					if (closed && code == CURLE_OK && request.http_code() == 200) {
+						report["downloaded"] = report["downloaded"].get<int>() + 1;
+					}
+					else {
+						boost::system::error_code error;
+						fs::remove(target, error);
+						report["failed"].push_back(resource);
+					}
+					--outstanding;
+					fetch_found();
+				});
+				return true;
+			};
+
+			fetch_found = [&]() {
+				while (outstanding < lookahead && not found.empty()) {
+					auto file = std::move(found.front());
+					found.pop_front();
+					if (fetch_file(file.first, file.second)) {
+						++outstanding;
+					}
+				}
+			};
+
+			walker folders{batch,
+				[this, &public_key](const std::string& directory, const json& options) {
+					return public_info_request(public_key, directory, options);
+				},
+				[&found, &fetch_found, &report](const json& item) {
+					auto file = item.find("file");
+					if (file != item.end() && file->is_string()) {
+						found.emplace_back(item["path"].get<std::string>(), file->get<std::string>());
+						fetch_found();
+					}
+					else if (file != item.end()) {
+						report["failed"].push_back(item["path"]);
+					}
+					return true;
+				}, {}};
+			folders.list(folder.string());
+			batch.run();
+			for (auto& directory : folders.failed) {
+				report["failed"].push_back(directory);
+			}
+			return report;
+		}
+		catch(...) {
+			return json();
+		}
+	}
+
+	auto Client::walk(url::path root, std::function<bool(const json& item)> visit, std::size_t parallelism) -> bool {
+
+		try {
+			detail::batch batch{*m_context, parallelism};
+			walker folders{batch,
+				[this](const std::string& directory, const json& options) {
+					return info_request(directory, options);
+				},
+				visit, {}};
+			folders.list(root.string());
+			batch.run();
+			return folders.failed.empty();
+		}
+		catch(...) {
+			return false;
+		}
+	}
+
+	auto Client::last_uploaded(json options) -> json {
+		return value_or_details(try_last_uploaded(options));
+	}
+
+	auto Client::try_last_uploaded(json options) -> result<json> {
+
+		try {
+			auto request = new_request("GET");
+			url::params_t url_params;
+			parse_limit (url_params, options);
+			parse_fields (url_params, options);
+			parse_preview_size (url_params, options);
+			parse_preview_crop (url_params, options);
+			parse_media_type (url_params, options);
+			request->set_url(api_url + "/resources/last-uploaded" + "?" + url_params.string());
+			auto auth = auth_header();
+			request->add_header(auth);
+			return perform_shared_request (*m_context, *request, auth);
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::files_request(json options) const -> std::unique_ptr<detail::request> {
+		auto request = new_request("GET");
+		auto url_params = parse_params_for_files(options);
+		request->set_url(api_url + "/resources/files" + "?" + url_params.string());
+		request->add_header(auth_header());
+		return request;
+	}
+
+	auto Client::list(json options) -> json {
+		return value_or_details(try_list(options));
+	}
+
+	auto Client::try_list(json options) -> result<json> {
+
+		try {
+			auto request = files_request(options);
+			return perform_shared_request (*m_context, *request, auth_header());
+		}
+		catch(...) {
+			return invalid_call();
+		}
+	}
+
+	auto Client::try_list_document(json options) -> result<document> {
+
+		try {
+			auto request = files_request(options);
+			return perform_shared_document_request (*m_context, *request, auth_header());
+		}
+		catch(...) {
+			return invalid_call().error();
+		}
+	}
+
+	auto Client::list(json options, std::function<bool(const json& item)> visit, std::size_t parallelism) -> bool {
+
+		try {
+			if (options.is_null()) options = json::object();
+			int limit = options.find("limit") != options.end() && options["limit"].is_number() ? options["limit"].get<int>() : 1000;
+			if (limit <= 0) limit = 1000;
+			int first = options.find("offset") != options.end() && options["offset"].is_number() ? options["offset"].get<int>() : 0;
+			if (first < 0) first = 0;
+			options["limit"] = limit;
+
+			detail::batch batch{*m_context, parallelism};
+			std::map<int, json> pages;
+			int next_offset = first;
+			int next_delivered = first;
+			int end = std::numeric_limits<int>::max();
+			std::size_t in_flight = 0;
+			bool stopped = false;
+			bool complete = true;
+
+			// pages come back in any order, items are passed to visit in order
+			std::function<void()> schedule;
+			auto deliver = [&]() {
+				for (auto page = pages.find(next_delivered); page != pages.end(); page = pages.find(next_delivered)) {
+					for (auto& item : page->second) {
+						if (not stopped && not visit(item)) stopped = true;
+					}
+					pages.erase(page);
+					next_delivered += limit;
+				}
+			};
+
+			std::function<void(int)> fetch = [&](int offset) {
+				auto page_options = options;
+				page_options["offset"] = offset;
+				++in_flight;
+				batch.add(files_request(page_options), [&, offset](CURLcode code, detail::request& request) {
+					--in_flight;
+					auto response = response_result(code, request);
+					auto& page = response.value();
+					auto items = page.find("items");
+					if (items == page.end() || not items->is_array()) {
+						complete = false;
+						stopped = true;
+						return;
+					}
+					auto total = page.find("total");
+					if (total != page.end() && total->is_number()) {
+						end = std::min(end, total->get<int>());
+					}
+					if (static_cast<int>(items->size()) < limit) {
+						end = std::min(end, offset + static_cast<int>(items->size()));
+					}
+					if (offset < end) pages[offset] = *items;
+					deliver();
+					schedule();
+				});
+			};
+
+			// without a known total further pages are requested speculatively,
+			// at most parallelism of them past the end. A slow page holds back
+			// the ones after it, so requests go at most window pages past the
+			// first one not delivered and the pages kept stay bounded.
+			auto window = static_cast<long long>(std::max<std::size_t>(parallelism, 1)) * 2 * limit;
+			schedule = [&]() {
+				while (not stopped && in_flight < parallelism && next_offset < end
+					&& next_offset - static_cast<long long>(next_delivered) < window) {
+					fetch(next_offset);
+					next_offset += limit;
+				}
+			};
+
+			fetch(next_offset);
+			next_offset += limit;
+			batch.run();
+			return complete;
+		}
+		catch(...) {
+			return false;
+		}
+	}
+}
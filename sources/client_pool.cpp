@@ -0,0 +1,47 @@
+#include <yadisk/client_pool.hpp>
+
+#include "context.hpp"
+
+namespace yadisk
+{
+	ClientPool::ClientPool(std::size_t slots) : m_base{""} {
+		m_base.m_context->tenants.set_slots(slots);
+	}
+
+	auto ClientPool::find(const string& account) -> std::shared_ptr<detail::tenant> {
+		auto& tenant = m_accounts[account];
+		if (tenant == nullptr) {
+			tenant = std::make_shared<detail::tenant>();
+		}
+		return tenant;
+	}
+
+	auto ClientPool::client(const string& account, const string& token) -> Client {
+		Client client = m_base;
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			client.m_tenant = find(account);
+		}
+		client.set_token(token);
+		return client;
+	}
+
+	auto ClientPool::set_limits(const string& account, limits_t limits) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_base.m_context->tenants.set_limits(*find(account), limits.weight, limits.rate);
+	}
+
+	auto ClientPool::remove(const string& account) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_accounts.erase(account);
+	}
+
+	auto ClientPool::size() const -> std::size_t {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_accounts.size();
+	}
+
+	auto ClientPool::stats() const -> Client::stats_t {
+		return m_base.stats();
+	}
+}
@@ -0,0 +1,289 @@
+#include <curl/curl.h>
+
+#include <stdexcept>
+#include <thread>
+
+#include "context.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	auto global_init() -> CURLcode {
+		// curl_global_init is not thread safe, so it runs under the guard of
+		// a function local static instead of at static initialization
+		static const struct environment
+		{
+			environment() : code{curl_global_init(CURL_GLOBAL_ALL)} {}
+			~environment() {
+				if (code == CURLE_OK) curl_global_cleanup();
+			}
+			CURLcode code;
+		} env;
+		return env.code;
+	}
+
+	context::context() : m_share{(global_init(), curl_share_init())} {
+		if (m_share == nullptr) {
+			throw std::runtime_error("curl_share_init");
+		}
+		curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &context::lock);
+		curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &context::unlock);
+		curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+		// connections are not shared: libcurl does not support a connection
+		// cache used by transfers on several threads at once, so each easy
+		// handle of the per thread cache and each multi handle keeps its own
+	}
+
+	context::~context() {
+		std::lock_guard<std::mutex> control{m_keep_alive_control};
+		stop_keep_alive();
+		curl_share_cleanup(m_share);
+	}
+
+	auto context::keep_alive(std::chrono::milliseconds interval, probe_t probe) -> void {
+		// the old thread is stopped and the new one started as one step,
+		// so calls from several threads do not leave a thread unjoined
+		std::lock_guard<std::mutex> control{m_keep_alive_control};
+		stop_keep_alive();
+		if (interval.count() <= 0) return;
+
+		{
+			std::lock_guard<std::mutex> lock{m_keep_alive_mutex};
+			m_keep_alive_stopped = false;
+		}
+		m_keep_alive = std::thread{[this, interval, probe]() {
+			std::unique_lock<std::mutex> lock{m_keep_alive_mutex};
+			while (not m_keep_alive_stopped) {
+				lock.unlock();
+				auto healthy = false;
+				try {
+					auto request = probe();
+					healthy = perform(*request) == CURLE_OK && request->http_code() < 500;
+				}
+				catch (...) {}
+				m_healthy.store(healthy, std::memory_order_relaxed);
+
+				lock.lock();
+				m_keep_alive_stop.wait_for(lock, interval, [this]() { return m_keep_alive_stopped; });
+			}
+		}};
+	}
+
+	auto context::stop_keep_alive() -> void {
+		if (not m_keep_alive.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock{m_keep_alive_mutex};
+			m_keep_alive_stopped = true;
+		}
+		m_keep_alive_stop.notify_all();
+		m_keep_alive.join();
+	}
+
+	auto context::acquire(request& request) -> bool {
+		if (request.tenant() != nullptr && not tenants.acquire(*request.tenant(), request)) {
+			return false;
+		}
+		if (not lanes.acquire(request.priority(), request)) {
+			if (request.tenant() != nullptr) {
+				tenants.release(*request.tenant());
+			}
+			return false;
+		}
+		return true;
+	}
+
+	auto context::try_acquire(request& request) -> bool {
+		if (request.tenant() != nullptr && not tenants.try_acquire(*request.tenant())) {
+			return false;
+		}
+		if (not lanes.try_acquire(request.priority())) {
+			if (request.tenant() != nullptr) {
+				tenants.release(*request.tenant());
+			}
+			return false;
+		}
+		return true;
+	}
+
+	auto context::release(request& request) -> void {
+		lanes.release(request.priority());
+		if (request.tenant() != nullptr) {
+			tenants.release(*request.tenant());
+		}
+	}
+
+	auto context::perform(request& request) -> CURLcode {
+		auto aborted = request.aborted();
+		if (aborted != CURLE_OK) {
+			return aborted;
+		}
+		// the wait for a turn may take the rest of the time
+		if (not acquire(request)) {
+			return request.aborted();
+		}
+
+		auto player = replaying();
+		if (player != nullptr) {
+			auto recorded = player->find(request);
+			std::this_thread::sleep_for(player->delay(recorded));
+			auto response_code = player->serve(request, recorded);
+			release(request);
+			account(recorded, response_code);
+			return response_code;
+		}
+
+		if (request.hedged()) {
+			return perform_hedged(request);
+		}
+
+		request.set_scheduler(lanes);
+		auto curl = request.prepare();
+		curl_easy_setopt(curl, CURLOPT_SHARE, m_share);
+
+		auto recorder = recording();
+		auto start = recorder != nullptr ? recorder->elapsed() : 0;
+		auto response_code = curl_easy_perform(curl);
+		release(request);
+		account(curl, response_code);
+		if (recorder != nullptr) {
+			recorder->record(request, response_code, start, recorder->elapsed() - start);
+		}
+		return response_code;
+	}
+
+	auto context::perform_hedged(request& primary) -> CURLcode {
+		using clock = std::chrono::steady_clock;
+		auto started = clock::now();
+		auto delay = hedges.delay(primary.hedge_percentile());
+
+		auto multi = curl_multi_init();
+		if (multi == nullptr) {
+			release(primary);
+			return CURLE_OUT_OF_MEMORY;
+		}
+		primary.set_scheduler(lanes);
+		auto first = primary.prepare();
+		curl_easy_setopt(first, CURLOPT_SHARE, m_share);
+		curl_multi_add_handle(multi, first);
+
+		auto recorder = recording();
+		auto start = recorder != nullptr ? recorder->elapsed() : 0;
+		std::unique_ptr<request> hedge;
+		std::size_t running = 1;
+		CURL * winner = nullptr;
+		CURLcode response_code = CURLE_OK;
+		while (winner == nullptr) {
+			int active = 0;
+			curl_multi_perform(multi, &active);
+
+			CURLMsg * message = nullptr;
+			int left = 0;
+			while (winner == nullptr && (message = curl_multi_info_read(multi, &left)) != nullptr) {
+				if (message->msg != CURLMSG_DONE) continue;
+				// a failed copy waits for the other one, if it still runs
+				if (message->data.result == CURLE_OK || --running == 0) {
+					winner = message->easy_handle;
+					response_code = message->data.result;
+				}
+			}
+			if (winner != nullptr) break;
+
+			auto elapsed = clock::now() - started;
+			if (elapsed >= delay) {
+				delay = hedger::duration::max();
+				if (hedges.try_hedge()) {
+					auto copy = primary.duplicate();
+					if (try_acquire(*copy)) {
+						copy->set_scheduler(lanes);
+						auto second = copy->prepare();
+						curl_easy_setopt(second, CURLOPT_SHARE, m_share);
+						curl_multi_add_handle(multi, second);
+						hedge = std::move(copy);
+						++running;
+						hedged.fetch_add(1, std::memory_order_relaxed);
+					}
+				}
+			}
+
+			long timeout = 100;
+			if (delay != hedger::duration::max()) {
+				auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(delay - elapsed).count();
+				timeout = std::max<long>(std::min<long>(static_cast<long>(remaining), timeout), 0);
+			}
+			// a copy paused by the bandwidth cap is resumed here
+			auto now = clock::now();
+			for (auto copy : { &primary, hedge.get() }) {
+				if (copy == nullptr) continue;
+				auto paused = std::chrono::duration_cast<std::chrono::milliseconds>(copy->resume(now)).count();
+				if (paused > 0) timeout = std::min<long>(timeout, static_cast<long>(paused));
+			}
+			curl_multi_wait(multi, nullptr, 0, static_cast<int>(timeout), nullptr);
+		}
+
+		// removing the copy still running drops its transfer
+		curl_multi_remove_handle(multi, first);
+		if (hedge != nullptr) {
+			curl_multi_remove_handle(multi, hedge->handle());
+		}
+		curl_multi_cleanup(multi);
+		release(primary);
+		if (hedge != nullptr) {
+			release(*hedge);
+			if (winner == hedge->handle()) {
+				primary.set_answered(response_code == CURLE_OK ? hedge->http_code() : 0);
+				primary.response().str(hedge->response().str());
+			}
+		}
+
+		account(winner, response_code);
+		hedges.record(clock::now() - started, primary.hedge_budget());
+		if (recorder != nullptr) {
+			recorder->record(primary, response_code, start, recorder->elapsed() - start);
+		}
+		return response_code;
+	}
+
+	auto context::account(CURL * curl, CURLcode response_code) -> void {
+		requests.fetch_add(1, std::memory_order_relaxed);
+		if (response_code != CURLE_OK) {
+			failures.fetch_add(1, std::memory_order_relaxed);
+		}
+
+#if LIBCURL_VERSION_NUM >= 0x073700
+		curl_off_t uploaded = 0, downloaded = 0;
+		curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+		curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+#else
+		double uploaded = 0, downloaded = 0;
+		curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD, &uploaded);
+		curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD, &downloaded);
+#endif
+		bytes_sent.fetch_add(static_cast<std::uint64_t>(uploaded), std::memory_order_relaxed);
+		bytes_received.fetch_add(static_cast<std::uint64_t>(downloaded), std::memory_order_relaxed);
+	}
+
+	auto context::account(const exchange * recorded, CURLcode response_code) -> void {
+		requests.fetch_add(1, std::memory_order_relaxed);
+		if (response_code != CURLE_OK) {
+			failures.fetch_add(1, std::memory_order_relaxed);
+		}
+		if (recorded != nullptr) {
+			bytes_sent.fetch_add(recorded->sent, std::memory_order_relaxed);
+			bytes_received.fetch_add(recorded->received, std::memory_order_relaxed);
+		}
+	}
+
+	void context::lock(CURL *, curl_lock_data data, curl_lock_access, void * userptr) {
+		auto self = reinterpret_cast<context *>(userptr);
+		self->m_locks[data].lock();
+	}
+
+	void context::unlock(CURL *, curl_lock_data data, void * userptr) {
+		auto self = reinterpret_cast<context *>(userptr);
+		self->m_locks[data].unlock();
+	}
+}
+}
@@ -0,0 +1,198 @@
+#ifndef __CONTEXT_HPP__
+#define __CONTEXT_HPP__
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "fair_share.hpp"
+#include "hedger.hpp"
+#include "known_directories.hpp"
+#include "limiter.hpp"
+#include "request.hpp"
+#include "scheduler.hpp"
+#include "single_flight.hpp"
+#include "transcript.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief initializes libcurl once per process, on the first call.
+    ///     The matching cleanup runs at exit.
+    ///
+    auto global_init() -> CURLcode;
+
+    ///
+    /// \brief state shared by every copy of a Client: the curl share handle
+    ///     (dns, tls sessions and, where supported, connections) and the
+    ///     request counters. All members are safe to use from any thread.
+    ///
+    class context
+    {
+    public:
+
+        context();
+
+        context(const context&) = delete;
+
+        auto operator=(const context&) -> context& = delete;
+
+        ~context();
+
+        auto share() -> CURLSH * {
+            return m_share;
+        }
+
+        ///
+        /// \brief prepares and performs request on the calling thread with
+        ///     the share handle attached, once its account has its turn and
+        ///     a connection of its class is free, and accounts the result.
+        ///
+        auto perform(request& request) -> CURLcode;
+
+        ///
+        /// \brief accounts a transfer finished outside of perform, e.g. by
+        ///     a multi handle.
+        ///
+        auto account(CURL * curl, CURLcode response_code) -> void;
+
+        ///
+        /// \brief accounts an exchange served from a transcript.
+        ///
+        auto account(const exchange * recorded, CURLcode response_code) -> void;
+
+        ///
+        /// \brief records exchanges performed from now on into a transcript
+        ///     file, nullptr stops recording.
+        ///
+        auto set_recorder(std::shared_ptr<recorder> recorder) -> void {
+            std::atomic_store(&m_recorder, recorder);
+        }
+
+        auto recording() const -> std::shared_ptr<recorder> {
+            return std::atomic_load(&m_recorder);
+        }
+
+        ///
+        /// \brief serves requests from a transcript instead of the network,
+        ///     nullptr goes back to the network.
+        ///
+        auto set_player(std::shared_ptr<player> player) -> void {
+            std::atomic_store(&m_player, player);
+        }
+
+        auto replaying() const -> std::shared_ptr<player> {
+            return std::atomic_load(&m_player);
+        }
+
+        std::atomic<std::uint64_t> requests{0};
+        std::atomic<std::uint64_t> failures{0};
+        std::atomic<std::uint64_t> bytes_sent{0};
+        std::atomic<std::uint64_t> bytes_received{0};
+        std::atomic<std::uint64_t> hedged{0};
+
+        ///
+        /// \brief identical idempotent requests in flight, shared by all
+        ///     threads using the context.
+        ///
+        single_flight flights;
+
+        ///
+        /// \brief directories made or found by Client::mkdir.
+        ///
+        known_directories directories;
+
+        ///
+        /// \brief latencies and budget of hedged requests.
+        ///
+        hedger hedges;
+
+        ///
+        /// \brief adaptive limits of requests in flight of batches, per host.
+        ///
+        host_limiters limits;
+
+        ///
+        /// \brief connection budgets and bandwidth caps of priority classes.
+        ///
+        scheduler lanes;
+
+        ///
+        /// \brief request slots of the accounts of a ClientPool.
+        ///
+        fair_share tenants;
+
+        ///
+        /// \brief takes the turn of the account of request and a connection
+        ///     of its class, as perform does.
+        /// \return false if request was cancelled or its deadline passed
+        ///     while it waited, it holds nothing then
+        ///
+        auto acquire(request& request) -> bool;
+
+        ///
+        /// \brief as acquire, but fails instead of waiting.
+        ///
+        auto try_acquire(request& request) -> bool;
+
+        auto release(request& request) -> void;
+
+        using probe_t = std::function<std::unique_ptr<request>()>;
+
+        ///
+        /// \brief performs a request made by probe every interval on a
+        ///     background thread, so the dns entry and the tls session stay
+        ///     fresh and the health of the api is known. A zero interval stops it.
+        ///
+        auto keep_alive(std::chrono::milliseconds interval, probe_t probe) -> void;
+
+        ///
+        /// \brief whether the last keep alive probe succeeded.
+        ///
+        auto healthy() const -> bool {
+            return m_healthy.load(std::memory_order_relaxed);
+        }
+
+    private:
+
+        ///
+        /// \brief performs request through a multi handle, adding its
+        ///     duplicate when hedges says it is late; the first success is
+        ///     the answer of request. request has its turn already.
+        ///
+        auto perform_hedged(request& request) -> CURLcode;
+
+        ///
+        /// \brief stops and joins the keep alive thread, the caller holds
+        ///     m_keep_alive_control.
+        ///
+        auto stop_keep_alive() -> void;
+
+        static void lock(CURL *, curl_lock_data data, curl_lock_access, void * userptr);
+
+        static void unlock(CURL *, curl_lock_data data, void * userptr);
+
+        CURLSH * m_share;
+        std::shared_ptr<recorder> m_recorder;
+        std::shared_ptr<player> m_player;
+        std::mutex m_locks[CURL_LOCK_DATA_LAST];
+        std::mutex m_keep_alive_control;
+        std::mutex m_keep_alive_mutex;
+        std::condition_variable m_keep_alive_stop;
+        bool m_keep_alive_stopped = false;
+        std::thread m_keep_alive;
+        std::atomic<bool> m_healthy{false};
+    };
+}
+}
+
+#endif // __CONTEXT_HPP__
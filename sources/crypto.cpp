@@ -0,0 +1,302 @@
+#include <yadisk/crypto.hpp>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "pipeline.hpp"
+
+namespace yadisk
+{
+	static const char magic[4] = {'Y', 'D', 'E', '1'};
+
+	const std::size_t encrypted_layout::header_size;
+	const std::size_t encrypted_layout::tag_size;
+	const std::size_t encrypted_layout::key_size;
+
+	// Runs AES-256-GCM over data in place. The chunk size and the last flag
+	// are authenticated, so frames can not be moved between contents with
+	// other chunking nor the content cut after a full frame.
+	static auto gcm(bool encrypt, const encrypted_layout& layout, const std::string& key,
+	                std::uint64_t index, bool last, unsigned char * data, std::size_t size,
+	                unsigned char * tag) -> bool {
+		if (index > std::numeric_limits<std::uint32_t>::max()) return false;
+
+		unsigned char nonce[12];
+		std::memcpy(nonce, layout.nonce, sizeof(layout.nonce));
+		for (int i = 0; i < 4; ++i) {
+			nonce[8 + i] = static_cast<unsigned char>(index >> (24 - 8 * i));
+		}
+		unsigned char aad[5];
+		for (int i = 0; i < 4; ++i) {
+			aad[i] = static_cast<unsigned char>(layout.chunk_size >> (8 * i));
+		}
+		aad[4] = last ? 1 : 0;
+
+		auto context = EVP_CIPHER_CTX_new();
+		if (context == nullptr) return false;
+
+		auto key_data = reinterpret_cast<const unsigned char *>(key.data());
+		int length = 0;
+		bool ok = false;
+		if (encrypt) {
+			ok = EVP_EncryptInit_ex(context, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1
+				&& EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, sizeof(nonce), nullptr) == 1
+				&& EVP_EncryptInit_ex(context, nullptr, nullptr, key_data, nonce) == 1
+				&& EVP_EncryptUpdate(context, nullptr, &length, aad, sizeof(aad)) == 1
+				&& EVP_EncryptUpdate(context, data, &length, data, static_cast<int>(size)) == 1
+				&& EVP_EncryptFinal_ex(context, data + length, &length) == 1
+				&& EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, encrypted_layout::tag_size, tag) == 1;
+		}
+		else {
+			ok = EVP_DecryptInit_ex(context, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1
+				&& EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, sizeof(nonce), nullptr) == 1
+				&& EVP_DecryptInit_ex(context, nullptr, nullptr, key_data, nonce) == 1
+				&& EVP_DecryptUpdate(context, nullptr, &length, aad, sizeof(aad)) == 1
+				&& EVP_DecryptUpdate(context, data, &length, data, static_cast<int>(size)) == 1
+				&& EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, encrypted_layout::tag_size, tag) == 1
+				&& EVP_DecryptFinal_ex(context, data + length, &length) == 1;
+		}
+		EVP_CIPHER_CTX_free(context);
+		return ok;
+	}
+
+	static auto check_key(const std::string& key) -> void {
+		if (key.size() != encrypted_layout::key_size) {
+			throw std::invalid_argument("key must be 32 bytes");
+		}
+	}
+
+	auto encrypted_layout::parse(const char * header, encrypted_layout& layout) -> bool {
+		if (std::memcmp(header, magic, sizeof(magic)) != 0) return false;
+
+		auto bytes = reinterpret_cast<const unsigned char *>(header);
+		layout.chunk_size = 0;
+		for (int i = 0; i < 4; ++i) {
+			layout.chunk_size |= static_cast<std::uint32_t>(bytes[4 + i]) << (8 * i);
+		}
+		std::memcpy(layout.nonce, bytes + 8, sizeof(layout.nonce));
+		return layout.chunk_size > 0;
+	}
+
+	auto encrypted_layout::frames(std::uint64_t encrypted_size) const -> std::uint64_t {
+		if (encrypted_size <= header_size) return 0;
+		return (encrypted_size - header_size + frame_size() - 1) / frame_size();
+	}
+
+	auto encrypted_layout::plaintext_size(std::uint64_t encrypted_size) const -> std::uint64_t {
+		auto count = frames(encrypted_size);
+		if (count == 0) return 0;
+		return encrypted_size - header_size - count * tag_size;
+	}
+
+	auto encrypted_layout::decrypt(const std::string& key, std::uint64_t index, bool last, std::string& frame) const -> bool {
+		if (frame.size() < tag_size || frame.size() > frame_size()) return false;
+
+		auto size = frame.size() - tag_size;
+		auto data = reinterpret_cast<unsigned char *>(&frame[0]);
+		if (not gcm(false, *this, key, index, last, data, size, data + size)) return false;
+		frame.resize(size);
+		return true;
+	}
+
+	auto encrypted_layout::encrypt(const std::string& key, std::uint64_t index, bool last, std::string& chunk) const -> bool {
+		auto size = chunk.size();
+		chunk.resize(size + tag_size);
+		auto data = reinterpret_cast<unsigned char *>(&chunk[0]);
+		return gcm(true, *this, key, index, last, data, size, data + size);
+	}
+
+	encrypting_source::encrypting_source(source& upstream, std::string key, std::size_t chunk_size, std::size_t workers)
+		: m_upstream(upstream), m_key{key} {
+		check_key(m_key);
+		if (chunk_size == 0 || chunk_size > std::numeric_limits<std::uint32_t>::max() - encrypted_layout::tag_size) {
+			throw std::invalid_argument("chunk_size");
+		}
+		m_layout.chunk_size = static_cast<std::uint32_t>(chunk_size);
+		if (RAND_bytes(m_layout.nonce, sizeof(m_layout.nonce)) != 1) {
+			throw std::runtime_error("RAND_bytes");
+		}
+
+		m_current.assign(magic, sizeof(magic));
+		for (int i = 0; i < 4; ++i) {
+			m_current.push_back(static_cast<char>(m_layout.chunk_size >> (8 * i)));
+		}
+		m_current.append(reinterpret_cast<const char *>(m_layout.nonce), sizeof(m_layout.nonce));
+
+		workers = std::max<std::size_t>(workers, 1);
+		m_pipeline.reset(new detail::ordered_pipeline{
+			[this](std::uint64_t index, bool last, std::string& chunk) {
+				return m_layout.encrypt(m_key, index, last, chunk);
+			}, workers, 2 * workers});
+	}
+
+	encrypting_source::~encrypting_source() {
+		if (not m_producer.joinable()) return;
+		m_pipeline->cancel();
+		m_producer.join();
+	}
+
+	auto encrypting_source::size() const -> std::int64_t {
+		auto size = m_upstream.size();
+		if (size < 0) return -1;
+		auto frames = std::max<std::int64_t>((size + m_layout.chunk_size - 1) / m_layout.chunk_size, 1);
+		return static_cast<std::int64_t>(encrypted_layout::header_size) + frames * static_cast<std::int64_t>(encrypted_layout::tag_size) + size;
+	}
+
+	auto encrypting_source::produce() -> void {
+		// fills chunk up to the chunk size, false if upstream failed
+		auto fill = [this](std::string& chunk) {
+			chunk.resize(m_layout.chunk_size);
+			std::size_t filled = 0;
+			while (filled < chunk.size()) {
+				auto count = m_upstream.read(&chunk[filled], chunk.size() - filled);
+				if (count == source::abort) return false;
+				if (count == 0) break;
+				filled += count;
+			}
+			chunk.resize(filled);
+			return true;
+		};
+
+		std::string chunk;
+		if (not fill(chunk)) {
+			m_pipeline->cancel();
+			return;
+		}
+		for (;;) {
+			// a full chunk is the last one only if nothing follows it
+			bool last = chunk.size() < m_layout.chunk_size;
+			std::string next;
+			if (not last) {
+				if (not fill(next)) {
+					m_pipeline->cancel();
+					return;
+				}
+				last = next.empty();
+			}
+			if (not m_pipeline->push(std::move(chunk), last)) return;
+			if (last) break;
+			chunk = std::move(next);
+		}
+		m_pipeline->finish();
+	}
+
+	auto encrypting_source::read(char * data, std::size_t size) -> std::size_t {
+		if (not m_producer.joinable()) {
+			m_producer = std::thread(&encrypting_source::produce, this);
+		}
+		std::size_t copied = 0;
+		while (copied < size) {
+			if (m_position == m_current.size()) {
+				m_position = 0;
+				if (not m_pipeline->pop(m_current)) {
+					m_current.clear();
+					if (m_pipeline->failed()) return source::abort;
+					break;
+				}
+				continue;
+			}
+			auto count = std::min(size - copied, m_current.size() - m_position);
+			std::memcpy(data + copied, m_current.data() + m_position, count);
+			m_position += count;
+			copied += count;
+		}
+		return copied;
+	}
+
+	decrypting_sink::decrypting_sink(sink& downstream, std::string key, std::size_t workers)
+		: m_downstream(downstream), m_key{key}, m_workers{std::max<std::size_t>(workers, 1)} {
+		check_key(m_key);
+	}
+
+	decrypting_sink::~decrypting_sink() {
+		if (m_consumer.joinable()) {
+			m_pipeline->cancel();
+			m_consumer.join();
+		}
+	}
+
+	auto decrypting_sink::reserve(std::uint64_t size) -> void {
+		m_reserved = size;
+	}
+
+	auto decrypting_sink::start() -> bool {
+		if (not encrypted_layout::parse(m_header.data(), m_layout)) return false;
+		if (m_reserved > 0) {
+			m_downstream.reserve(m_layout.plaintext_size(m_reserved));
+		}
+		m_pipeline.reset(new detail::ordered_pipeline{
+			[this](std::uint64_t index, bool last, std::string& frame) {
+				return m_layout.decrypt(m_key, index, last, frame);
+			}, m_workers, 2 * m_workers});
+		m_consumer = std::thread(&decrypting_sink::consume, this);
+		return true;
+	}
+
+	auto decrypting_sink::push_frame(bool last) -> bool {
+		std::string frame;
+		frame.swap(m_frame);
+		return m_pipeline->push(std::move(frame), last);
+	}
+
+	auto decrypting_sink::write(const char * data, std::size_t size) -> bool {
+		if (m_failed || (m_pipeline != nullptr && m_pipeline->failed())) return false;
+
+		while (size > 0) {
+			std::size_t count = 0;
+			if (m_header.size() < encrypted_layout::header_size) {
+				count = std::min(size, encrypted_layout::header_size - m_header.size());
+				m_header.append(data, count);
+				if (m_header.size() == encrypted_layout::header_size && not start()) {
+					m_failed = true;
+					return false;
+				}
+			}
+			else {
+				// a full frame is kept until more data shows it is not the last
+				if (m_frame.size() == m_layout.frame_size() && not push_frame(false)) {
+					m_failed = true;
+					return false;
+				}
+				count = std::min(size, m_layout.frame_size() - m_frame.size());
+				m_frame.append(data, count);
+			}
+			data += count;
+			size -= count;
+		}
+		return true;
+	}
+
+	auto decrypting_sink::close() -> bool {
+		if (m_closed) return not m_failed;
+		m_closed = true;
+
+		if (m_pipeline == nullptr || m_failed) {
+			// not encrypted content
+			m_failed = true;
+			return false;
+		}
+		if (m_frame.size() < encrypted_layout::tag_size || not push_frame(true)) {
+			m_pipeline->cancel();
+		}
+		m_pipeline->finish();
+		m_consumer.join();
+		m_failed = m_pipeline->failed() || not m_downstream.close();
+		return not m_failed;
+	}
+
+	auto decrypting_sink::consume() -> void {
+		std::string chunk;
+		while (m_pipeline->pop(chunk)) {
+			if (not m_downstream.write(chunk.data(), chunk.size())) {
+				m_pipeline->cancel();
+				return;
+			}
+		}
+	}
+}
@@ -0,0 +1,128 @@
+#include <yadisk/document.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace yadisk
+{
+namespace detail
+{
+	///
+	/// \brief monotonic memory of a document: allocation bumps a pointer in
+	///     the last block, nothing is freed before the arena itself.
+	///
+	class arena
+	{
+	public:
+
+		explicit arena(std::size_t block_size) : m_block_size{block_size} {}
+
+		auto allocate(std::size_t size, std::size_t alignment) -> char * {
+			auto offset = (alignment - reinterpret_cast<std::uintptr_t>(m_next) % alignment) % alignment;
+			if (m_next == nullptr || static_cast<std::size_t>(m_end - m_next) < offset + size) {
+				// blocks grow, so a large document takes few of them
+				auto block_size = std::max(m_block_size, size + alignment);
+				m_blocks.emplace_back(new char[block_size]);
+				m_capacity += block_size;
+				m_next = m_blocks.back().get();
+				m_end = m_next + block_size;
+				m_block_size = std::min(m_block_size * 2, max_block_size);
+				offset = (alignment - reinterpret_cast<std::uintptr_t>(m_next) % alignment) % alignment;
+			}
+			auto data = m_next + offset;
+			m_next = data + size;
+			return data;
+		}
+
+		auto allocations() const -> std::size_t {
+			return m_blocks.size();
+		}
+
+		auto capacity() const -> std::size_t {
+			return m_capacity;
+		}
+
+	private:
+
+		static const std::size_t max_block_size = 1 << 20;
+
+		std::vector<std::unique_ptr<char[]>> m_blocks;
+		std::size_t m_block_size;
+		std::size_t m_capacity = 0;
+		char * m_next = nullptr;
+		char * m_end = nullptr;
+	};
+
+	const std::size_t arena::max_block_size;
+
+	// arena being filled by a parse on this thread
+	static thread_local arena * current = nullptr;
+
+	// Every node is preceded by its owner, an arena or nullptr for the heap,
+	// so an allocator without state frees each node the right way.
+	static auto header_size(std::size_t alignment) -> std::size_t {
+		return std::max(alignment, sizeof(arena *));
+	}
+
+	auto arena_allocate(std::size_t size, std::size_t alignment) -> void * {
+		auto header = header_size(alignment);
+		char * data = nullptr;
+		if (current != nullptr) {
+			data = current->allocate(header + size, std::max(alignment, alignof(arena *)));
+		}
+		else {
+			data = static_cast<char *>(::operator new(header + size));
+		}
+		data += header;
+		reinterpret_cast<arena **>(data)[-1] = current;
+		return data;
+	}
+
+	auto arena_deallocate(void * data, std::size_t, std::size_t alignment) -> void {
+		if (data == nullptr) return;
+		if (static_cast<arena **>(data)[-1] == nullptr) {
+			::operator delete(static_cast<char *>(data) - header_size(alignment));
+		}
+	}
+}
+
+	document::document() {}
+
+	document::document(document&& other) : m_arena{std::move(other.m_arena)}, m_root(std::move(other.m_root)) {}
+
+	auto document::operator=(document&& other) -> document& {
+		// nodes of the old root are released while their arena is alive
+		m_root = std::move(other.m_root);
+		m_arena = std::move(other.m_arena);
+		return *this;
+	}
+
+	document::~document() {}
+
+	auto document::parse(const std::string& text) -> document {
+		document parsed;
+		// a parsed response takes about twice its text
+		parsed.m_arena.reset(new detail::arena{std::max<std::size_t>(text.size() * 2, 4096)});
+
+		struct scope
+		{
+			explicit scope(detail::arena * arena) {
+				detail::current = arena;
+			}
+			~scope() {
+				detail::current = nullptr;
+			}
+		} filling{parsed.m_arena.get()};
+		parsed.m_root = arena_json::parse(text);
+		return parsed;
+	}
+
+	auto document::allocations() const -> std::size_t {
+		return m_arena != nullptr ? m_arena->allocations() : 0;
+	}
+
+	auto document::capacity() const -> std::size_t {
+		return m_arena != nullptr ? m_arena->capacity() : 0;
+	}
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#include "fair_share.hpp"
+#include "request.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	auto fair_share::set_slots(std::size_t slots) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_slots = slots;
+		dispatch();
+	}
+
+	auto fair_share::set_limits(tenant& tenant, std::size_t weight, std::uint64_t requests_per_second) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		tenant.weight = std::max<std::size_t>(weight, 1);
+		tenant.rate.set_rate(requests_per_second);
+	}
+
+	auto fair_share::acquire(tenant& tenant, const request& request) -> bool {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		// the request waits for its rate outside of the ring, so it holds
+		// back neither its account nor the others
+		auto now = std::chrono::steady_clock::now();
+		auto ready = now + tenant.rate.take(1, now);
+		if (not request.wait(m_granted, lock, ready, [ready]() { return std::chrono::steady_clock::now() >= ready; })) {
+			return false;
+		}
+
+		if (tenant.waiting++ == 0) {
+			m_ring.push_back(&tenant);
+		}
+		dispatch();
+		auto max = std::chrono::steady_clock::time_point::max();
+		if (not request.wait(m_granted, lock, max, [&tenant]() { return tenant.granted > 0; })) {
+			// the request gives up its place in the ring
+			if (--tenant.waiting == 0) {
+				tenant.deficit = 0;
+				m_ring.erase(std::find(m_ring.begin(), m_ring.end(), &tenant));
+			}
+			return false;
+		}
+		--tenant.granted;
+		return true;
+	}
+
+	auto fair_share::try_acquire(tenant& tenant) -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		if (not m_ring.empty() || (m_slots != 0 && m_active >= m_slots)) {
+			return false;
+		}
+		auto now = std::chrono::steady_clock::now();
+		if (tenant.rate.take(0, now) > std::chrono::steady_clock::duration::zero()) {
+			return false;
+		}
+		tenant.rate.take(1, now);
+		++m_active;
+		return true;
+	}
+
+	auto fair_share::release(tenant&) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		--m_active;
+		dispatch();
+	}
+
+	auto fair_share::dispatch() -> void {
+		auto granted = false;
+		while ((m_slots == 0 || m_active < m_slots) && not m_ring.empty()) {
+			auto next = m_ring.front();
+			// a new turn of the account adds its quantum
+			if (next->deficit == 0) {
+				next->deficit = next->weight;
+			}
+			--next->deficit;
+			--next->waiting;
+			++next->granted;
+			++m_active;
+			granted = true;
+
+			if (next->waiting == 0) {
+				// an idle account does not save its turn for later
+				next->deficit = 0;
+				m_ring.pop_front();
+			}
+			else if (next->deficit == 0) {
+				m_ring.pop_front();
+				m_ring.push_back(next);
+			}
+		}
+		if (granted) {
+			m_granted.notify_all();
+		}
+	}
+}
+}
@@ -0,0 +1,80 @@
+#ifndef __FAIR_SHARE_HPP__
+#define __FAIR_SHARE_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "scheduler.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+    class request;
+
+    ///
+    /// \brief an account of a ClientPool. Members are guarded by the mutex
+    ///     of the fair_share it is used with.
+    ///
+    struct tenant
+    {
+        /// requests granted per round while other accounts wait
+        std::size_t weight = 1;
+        /// requests per second, 0 is unlimited
+        token_bucket rate;
+        std::size_t deficit = 0;
+        std::size_t waiting = 0;
+        std::size_t granted = 0;
+    };
+
+    ///
+    /// \brief divides a number of request slots between accounts by deficit
+    ///     round robin: while slots are short, every waiting account gets
+    ///     weight requests per round in turn, so a busy account can not
+    ///     starve the others. Requests over the rate of an account wait
+    ///     without holding a slot. Safe to use from any thread.
+    ///
+    class fair_share
+    {
+    public:
+
+        ///
+        /// \brief requests in flight of all accounts together, 0 is
+        ///     unlimited.
+        ///
+        auto set_slots(std::size_t slots) -> void;
+
+        auto set_limits(tenant& tenant, std::size_t weight, std::uint64_t requests_per_second) -> void;
+
+        ///
+        /// \brief waits for the rate of tenant and then for its turn, as
+        ///     long as request is neither cancelled nor past its deadline.
+        /// \return false if request was aborted before its turn
+        ///
+        auto acquire(tenant& tenant, const request& request) -> bool;
+
+        ///
+        /// \brief takes a slot only if one is free, nobody waits for it and
+        ///     the rate of tenant allows.
+        ///
+        auto try_acquire(tenant& tenant) -> bool;
+
+        auto release(tenant& tenant) -> void;
+
+    private:
+
+        auto dispatch() -> void;
+
+        std::mutex m_mutex;
+        std::condition_variable m_granted;
+        std::size_t m_slots = 0;
+        std::size_t m_active = 0;
+        std::deque<tenant *> m_ring;
+    };
+}
+}
+
+#endif // __FAIR_SHARE_HPP__
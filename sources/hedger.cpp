@@ -0,0 +1,51 @@
+#include <algorithm>
+
+#include "hedger.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	const std::size_t hedger::min_samples;
+	const std::size_t hedger::window;
+
+	// unused budget is kept up to a few hedges, so a burst of slow calls
+	// right after a quiet period is covered
+	static const double max_credit = 10;
+
+	auto hedger::delay(double percentile) -> duration {
+		std::vector<duration> samples;
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			if (m_samples.size() < min_samples) {
+				return duration::max();
+			}
+			samples = m_samples;
+		}
+		auto rank = static_cast<std::size_t>(std::min(std::max(percentile, 0.0), 1.0) * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+		return samples[rank];
+	}
+
+	auto hedger::record(duration latency, double budget) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		if (m_samples.size() < window) {
+			m_samples.push_back(latency);
+		}
+		else {
+			m_samples[m_next] = latency;
+			m_next = (m_next + 1) % window;
+		}
+		m_credit = std::min(m_credit + budget, max_credit);
+	}
+
+	auto hedger::try_hedge() -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		if (m_credit < 1) {
+			return false;
+		}
+		m_credit -= 1;
+		return true;
+	}
+}
+}
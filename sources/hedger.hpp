@@ -0,0 +1,58 @@
+#ifndef __HEDGER_HPP__
+#define __HEDGER_HPP__
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief decides when a request is late enough to be sent once more:
+    ///     after a percentile of the latencies of recent hedged calls, and
+    ///     only while the budget allows. Every call earns budget of a
+    ///     hedge, a hedge spends one, so at most that share of calls is
+    ///     sent twice. Safe to use from any thread.
+    ///
+    class hedger
+    {
+    public:
+
+        using duration = std::chrono::steady_clock::duration;
+
+        /// calls measured before hedging starts
+        static const std::size_t min_samples = 16;
+
+        ///
+        /// \brief time to wait for an answer before hedging, duration::max()
+        ///     while there are too few samples.
+        ///
+        auto delay(double percentile) -> duration;
+
+        ///
+        /// \brief records latency of a finished call and earns budget.
+        ///
+        auto record(duration latency, double budget) -> void;
+
+        ///
+        /// \brief spends the budget of one hedge.
+        /// \return false if there is not enough of it
+        ///
+        auto try_hedge() -> bool;
+
+    private:
+
+        static const std::size_t window = 256;
+
+        std::mutex m_mutex;
+        std::vector<duration> m_samples;
+        std::size_t m_next = 0;
+        double m_credit = 0;
+    };
+}
+}
+
+#endif // __HEDGER_HPP__
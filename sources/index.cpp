@@ -0,0 +1,388 @@
+#include <yadisk/index.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+
+namespace yadisk
+{
+	// Layout of the index file: header, then columns of count items each
+	// (path and resource id offsets have count + 1 items), then the string
+	// pool starting with the root path.
+	struct index_header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t count;
+		std::int64_t refreshed;
+		std::uint64_t root_size;
+		std::uint64_t pool_size;
+		std::uint64_t reserved;
+	};
+
+	static const char index_magic[4] = {'Y', 'D', 'I', 'X'};
+	static const std::uint32_t index_version = 1;
+
+	enum index_flags : unsigned char
+	{
+		directory_flag = 1,
+		md5_flag = 2
+	};
+
+	static auto days_from_civil(std::int64_t y, unsigned m, unsigned d) -> std::int64_t {
+		y -= m <= 2;
+		const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+		const unsigned yoe = static_cast<unsigned>(y - era * 400);
+		const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+		const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+	}
+
+	// parses "2017-04-07T10:41:09+00:00" into unix time
+	static auto parse_time(const std::string& text) -> std::int64_t {
+		int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0, zone_hour = 0, zone_minute = 0;
+		char sign = '+';
+		auto parsed = std::sscanf(text.c_str(), "%d-%d-%dT%d:%d:%d%c%d:%d",
+			&year, &month, &day, &hour, &minute, &second, &sign, &zone_hour, &zone_minute);
+		if (parsed < 6) return 0;
+		std::int64_t time = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+		if (parsed == 9) {
+			std::int64_t zone = zone_hour * 3600 + zone_minute * 60;
+			time += sign == '-' ? zone : -zone;
+		}
+		return time;
+	}
+
+	static auto parse_md5(const std::string& hex, unsigned char * out) -> bool {
+		if (hex.size() != 32) return false;
+		for (std::size_t i = 0; i < 16; ++i) {
+			unsigned value = 0;
+			if (std::sscanf(hex.c_str() + 2 * i, "%2x", &value) != 1) return false;
+			out[i] = static_cast<unsigned char>(value);
+		}
+		return true;
+	}
+
+	static auto format_md5(const unsigned char * md5) -> std::string {
+		static const char digits[] = "0123456789abcdef";
+		std::string hex;
+		for (std::size_t i = 0; i < 16; ++i) {
+			hex.push_back(digits[md5[i] >> 4]);
+			hex.push_back(digits[md5[i] & 0x0f]);
+		}
+		return hex;
+	}
+
+	static auto normalize(std::string path) -> std::string {
+		static const std::string prefix = "disk:";
+		if (path.compare(0, prefix.size(), prefix) == 0) path = path.substr(prefix.size());
+		if (path.empty()) path = "/";
+		if (path.size() > 1 && path.back() == '/') path.pop_back();
+		return path;
+	}
+
+	static auto parent_of(const std::string& path) -> std::string {
+		auto slash = path.rfind('/');
+		return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+	}
+
+	// prefix shared by all descendants of folder
+	static auto descendants_prefix(const std::string& folder) -> std::string {
+		return folder == "/" ? folder : folder + "/";
+	}
+
+	static auto to_entry(const json& item) -> Index::entry_t {
+		Index::entry_t entry;
+		entry.path = normalize(item["path"].get<std::string>());
+		entry.directory = item["type"].get<std::string>() == "dir";
+		entry.size = item.find("size") != item.end() ? item["size"].get<std::uint64_t>() : 0;
+		entry.modified = item.find("modified") != item.end() ? parse_time(item["modified"].get<std::string>()) : 0;
+		entry.md5 = item.find("md5") != item.end() ? item["md5"].get<std::string>() : "";
+		entry.resource_id = item.find("resource_id") != item.end() ? item["resource_id"].get<std::string>() : "";
+		return entry;
+	}
+
+	Index::Index(fs::path file) : m_path{file} {
+		open();
+	}
+
+	Index::~Index() {}
+
+	auto Index::open() -> void {
+		m_file.reset();
+		m_count = 0;
+		m_refreshed = 0;
+		if (not fs::exists(m_path)) return;
+
+		std::unique_ptr<detail::mapped_file> file{new detail::mapped_file{m_path}};
+		if (file->size() < sizeof(index_header)) {
+			throw std::runtime_error("index is truncated");
+		}
+		index_header header;
+		std::memcpy(&header, file->data(), sizeof(header));
+		if (std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 || header.version != index_version) {
+			throw std::runtime_error("index has unknown format");
+		}
+
+		auto count = static_cast<std::size_t>(header.count);
+		auto expected = sizeof(index_header) + (count + 1) * 16 + count * (8 + 8 + 16 + 1) + header.pool_size;
+		if (file->size() < expected) {
+			throw std::runtime_error("index is truncated");
+		}
+
+		auto data = file->data() + sizeof(index_header);
+		m_path_offsets = reinterpret_cast<const std::uint64_t *>(data);
+		data += (count + 1) * 8;
+		m_id_offsets = reinterpret_cast<const std::uint64_t *>(data);
+		data += (count + 1) * 8;
+		m_sizes = reinterpret_cast<const std::uint64_t *>(data);
+		data += count * 8;
+		m_modified = reinterpret_cast<const std::int64_t *>(data);
+		data += count * 8;
+		m_md5 = reinterpret_cast<const unsigned char *>(data);
+		data += count * 16;
+		m_flags = reinterpret_cast<const unsigned char *>(data);
+		data += count;
+		m_pool = data;
+
+		m_root.assign(m_pool, static_cast<std::size_t>(header.root_size));
+		m_count = count;
+		m_refreshed = header.refreshed;
+		m_file = std::move(file);
+	}
+
+	auto Index::write(std::vector<entry_t>& entries, std::int64_t refreshed) -> void {
+		std::sort(entries.begin(), entries.end(), [](const entry_t& lhs, const entry_t& rhs) {
+			return lhs.path < rhs.path;
+		});
+
+		auto count = entries.size();
+		std::vector<std::uint64_t> path_offsets, id_offsets, sizes;
+		std::vector<std::int64_t> modified;
+		std::vector<unsigned char> md5(count * 16), flags;
+		std::string pool = m_root;
+
+		for (std::size_t i = 0; i < count; ++i) {
+			auto& entry = entries[i];
+			path_offsets.push_back(pool.size());
+			pool += entry.path;
+			sizes.push_back(entry.size);
+			modified.push_back(entry.modified);
+			unsigned char flag = entry.directory ? directory_flag : 0;
+			if (parse_md5(entry.md5, md5.data() + i * 16)) flag |= md5_flag;
+			flags.push_back(flag);
+		}
+		path_offsets.push_back(pool.size());
+		for (auto& entry : entries) {
+			id_offsets.push_back(pool.size());
+			pool += entry.resource_id;
+		}
+		id_offsets.push_back(pool.size());
+
+		index_header header;
+		std::memcpy(header.magic, index_magic, sizeof(index_magic));
+		header.version = index_version;
+		header.count = count;
+		header.refreshed = refreshed;
+		header.root_size = m_root.size();
+		header.pool_size = pool.size();
+		header.reserved = 0;
+
+		auto temporary = m_path;
+		temporary += ".tmp";
+		{
+			std::ofstream out{temporary.string(), std::ios::binary | std::ios::trunc};
+			out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char *>(path_offsets.data()), path_offsets.size() * 8);
+			out.write(reinterpret_cast<const char *>(id_offsets.data()), id_offsets.size() * 8);
+			out.write(reinterpret_cast<const char *>(sizes.data()), sizes.size() * 8);
+			out.write(reinterpret_cast<const char *>(modified.data()), modified.size() * 8);
+			out.write(reinterpret_cast<const char *>(md5.data()), md5.size());
+			out.write(reinterpret_cast<const char *>(flags.data()), flags.size());
+			out.write(pool.data(), pool.size());
+			if (not out) {
+				throw std::runtime_error("write index");
+			}
+		}
+		m_file.reset();
+		fs::rename(temporary, m_path);
+		open();
+	}
+
+	auto Index::build(Client& client, url::path root, std::size_t parallelism) -> bool {
+		auto started = static_cast<std::int64_t>(std::time(nullptr));
+		std::vector<entry_t> entries;
+		auto complete = client.walk(root, [&entries](const json& item) {
+			entries.push_back(to_entry(item));
+			return true;
+		}, parallelism);
+		if (not complete) return false;
+
+		m_root = normalize(root.string());
+		write(entries, started);
+		return true;
+	}
+
+	auto Index::refresh(Client& client, std::size_t parallelism) -> bool {
+		if (m_file == nullptr) return build(client, "/", parallelism);
+
+		auto started = static_cast<std::int64_t>(std::time(nullptr));
+		std::map<std::string, entry_t> entries;
+		for (std::size_t i = 0; i < m_count; ++i) {
+			auto item = entry(i);
+			entries[item.path] = item;
+		}
+
+		// directories listed during this refresh, their children are exact
+		std::set<std::string> listed{m_root};
+		std::set<std::string> seen;
+		auto complete = client.walk(m_root, [&](const json& item) {
+			auto fresh = to_entry(item);
+			auto known = entries.find(fresh.path);
+			bool descend = fresh.directory && (known == entries.end() || known->second.modified != fresh.modified);
+			seen.insert(fresh.path);
+			entries[fresh.path] = fresh;
+			if (descend) listed.insert(fresh.path);
+			return descend;
+		}, parallelism);
+		if (not complete) return false;
+
+		std::vector<std::string> removed;
+		for (auto& item : entries) {
+			if (seen.count(item.first) == 0 && listed.count(parent_of(item.first)) != 0) {
+				removed.push_back(item.first);
+			}
+		}
+		for (auto& path : removed) {
+			entries.erase(path);
+			auto prefix = descendants_prefix(path);
+			auto first = entries.lower_bound(prefix);
+			auto last = first;
+			while (last != entries.end() && last->first.compare(0, prefix.size(), prefix) == 0) ++last;
+			entries.erase(first, last);
+		}
+
+		// uploads into directories whose time did not change
+		json options;
+		options["limit"] = 1000;
+		auto uploaded = client.last_uploaded(options);
+		auto items = uploaded.find("items");
+		if (items != uploaded.end()) {
+			auto root_prefix = descendants_prefix(m_root);
+			for (auto& item : *items) {
+				auto fresh = to_entry(item);
+				if (fresh.modified < m_refreshed) continue;
+				if (fresh.path.compare(0, root_prefix.size(), root_prefix) != 0) continue;
+				entries[fresh.path] = fresh;
+			}
+		}
+
+		std::vector<entry_t> result;
+		result.reserve(entries.size());
+		for (auto& item : entries) result.push_back(item.second);
+		write(result, started);
+		return true;
+	}
+
+	auto Index::size() const -> std::size_t {
+		return m_count;
+	}
+
+	auto Index::refreshed() const -> std::int64_t {
+		return m_refreshed;
+	}
+
+	auto Index::path(std::size_t i) const -> string {
+		return string(m_pool + m_path_offsets[i], m_pool + m_path_offsets[i + 1]);
+	}
+
+	auto Index::entry(std::size_t i) const -> entry_t {
+		entry_t result;
+		result.path = path(i);
+		result.size = m_sizes[i];
+		result.modified = m_modified[i];
+		result.md5 = (m_flags[i] & md5_flag) ? format_md5(m_md5 + i * 16) : "";
+		result.resource_id.assign(m_pool + m_id_offsets[i], m_pool + m_id_offsets[i + 1]);
+		result.directory = (m_flags[i] & directory_flag) != 0;
+		return result;
+	}
+
+	auto Index::lower_bound(const string& target) const -> std::size_t {
+		std::size_t first = 0, count = m_count;
+		while (count > 0) {
+			auto step = count / 2;
+			auto middle = first + step;
+			auto length = static_cast<std::size_t>(m_path_offsets[middle + 1] - m_path_offsets[middle]);
+			auto compared = target.compare(0, string::npos, m_pool + m_path_offsets[middle], length);
+			if (compared > 0) {
+				first = middle + 1;
+				count -= step + 1;
+			}
+			else {
+				count = step;
+			}
+		}
+		return first;
+	}
+
+	auto Index::find(const string& target) const -> boost::optional<entry_t> {
+		auto normalized = normalize(target);
+		auto i = lower_bound(normalized);
+		if (i == m_count || path(i) != normalized) return boost::none;
+		return entry(i);
+	}
+
+	auto Index::folder_size(const string& folder) const -> std::uint64_t {
+		auto prefix = descendants_prefix(normalize(folder));
+		std::uint64_t total = 0;
+		for (auto i = lower_bound(prefix); i < m_count; ++i) {
+			auto length = static_cast<std::size_t>(m_path_offsets[i + 1] - m_path_offsets[i]);
+			if (length < prefix.size() || std::memcmp(m_pool + m_path_offsets[i], prefix.data(), prefix.size()) != 0) break;
+			if (not (m_flags[i] & directory_flag)) total += m_sizes[i];
+		}
+		return total;
+	}
+
+	auto Index::list(const string& folder) const -> std::vector<entry_t> {
+		auto prefix = descendants_prefix(normalize(folder));
+		std::vector<entry_t> children;
+		auto i = lower_bound(prefix);
+		while (i < m_count) {
+			auto descendant = path(i);
+			if (descendant.compare(0, prefix.size(), prefix) != 0) break;
+			auto slash = descendant.find('/', prefix.size());
+			if (slash == string::npos) {
+				children.push_back(entry(i));
+				++i;
+				continue;
+			}
+			// skip the rest of the subtree of that child
+			auto next = descendant.substr(0, slash);
+			next.push_back('/' + 1);
+			i = lower_bound(next);
+		}
+		return children;
+	}
+
+	auto Index::find_name(const string& name) const -> std::vector<entry_t> {
+		std::vector<entry_t> found;
+		for (std::size_t i = 0; i < m_count; ++i) {
+			auto begin = m_pool + m_path_offsets[i];
+			auto end = m_pool + m_path_offsets[i + 1];
+			auto length = static_cast<std::size_t>(end - begin);
+			if (length <= name.size()) continue;
+			if (*(end - name.size() - 1) != '/') continue;
+			if (std::memcmp(end - name.size(), name.data(), name.size()) == 0) {
+				found.push_back(entry(i));
+			}
+		}
+		return found;
+	}
+}
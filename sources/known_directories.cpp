@@ -0,0 +1,35 @@
+#include "known_directories.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	auto known_directories::contains(const std::string& key) const -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_keys.find(key) != m_keys.end();
+	}
+
+	auto known_directories::insert(const std::string& key) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_keys.insert(key);
+	}
+
+	auto known_directories::forget(const std::string& key) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_keys.erase(key);
+		// directories below key follow it in order, "/a/" sorts before "/a0"
+		auto prefix = key + "/";
+		auto first = m_keys.lower_bound(prefix);
+		auto last = first;
+		while (last != m_keys.end() && last->compare(0, prefix.size(), prefix) == 0) {
+			++last;
+		}
+		m_keys.erase(first, last);
+	}
+
+	auto known_directories::size() const -> std::size_t {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_keys.size();
+	}
+}
+}
@@ -0,0 +1,42 @@
+#ifndef __KNOWN_DIRECTORIES_HPP__
+#define __KNOWN_DIRECTORIES_HPP__
+
+#include <cstddef>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief directories known to exist, so creating a tree does not ask
+    ///     for parents made by an earlier call. Keys are the account and the
+    ///     path, "<authorization>\n/a/b". A directory gone since is
+    ///     forgotten when creating a child of it fails.
+    ///
+    class known_directories
+    {
+    public:
+
+        auto contains(const std::string& key) const -> bool;
+
+        auto insert(const std::string& key) -> void;
+
+        ///
+        /// \brief forgets key and the directories below it.
+        ///
+        auto forget(const std::string& key) -> void;
+
+        auto size() const -> std::size_t;
+
+    private:
+
+        mutable std::mutex m_mutex;
+        std::set<std::string> m_keys;
+    };
+}
+}
+
+#endif // __KNOWN_DIRECTORIES_HPP__
@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "limiter.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	// latency this much above the lowest seen is taken for queueing
+	static const double tolerance = 2.0;
+	// weight of a new sample in the smoothed latency
+	static const double smoothing = 0.2;
+	// requests in flight to a host before its first response, the limit
+	// grows from here in slow start
+	static const std::size_t initial_limit = 4;
+	static const std::size_t max_limit = 64;
+
+	limiter::limiter(std::size_t initial, std::size_t maximum)
+		: m_limit{static_cast<double>(std::max<std::size_t>(std::min(initial, maximum), 1))},
+		  m_maximum{static_cast<double>(std::max<std::size_t>(maximum, 1))} {}
+
+	auto limiter::limit() const -> std::size_t {
+		return static_cast<std::size_t>(m_limit);
+	}
+
+	auto limiter::update(double latency, bool throttled) -> void {
+		++m_since_decrease;
+		if (throttled) {
+			decrease(0.5);
+			return;
+		}
+		if (latency <= 0) {
+			return;
+		}
+
+		m_min_latency = m_min_latency == 0 ? latency : std::min(m_min_latency, latency);
+		m_latency = m_latency == 0 ? latency : (1 - smoothing) * m_latency + smoothing * latency;
+		if (m_latency > tolerance * m_min_latency) {
+			decrease(0.9);
+			return;
+		}
+
+		// one success per request in flight makes a round trip
+		m_limit = std::min(m_maximum, m_limit + (m_slow_start ? 1.0 : 1.0 / m_limit));
+	}
+
+	auto limiter::decrease(double factor) -> void {
+		// responses to requests sent before the previous decrease do not
+		// tell anything about the new limit
+		if (m_since_decrease < limit()) {
+			return;
+		}
+		m_since_decrease = 0;
+		m_slow_start = false;
+		if (m_limit < 2) {
+			// latency stays high even one at a time: the path got slower,
+			// take it as the new baseline
+			m_min_latency = m_latency;
+		}
+		m_limit = std::max(1.0, m_limit * factor);
+	}
+	host_limiters::host_t::host_t() : limits{initial_limit, max_limit} {}
+
+	auto host_limiters::try_acquire(const std::string& host) -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto& entry = m_hosts[host];
+		if (entry.in_flight >= entry.limits.limit()) {
+			return false;
+		}
+		++entry.in_flight;
+		return true;
+	}
+
+	auto host_limiters::acquire(const std::string& host) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		++m_hosts[host].in_flight;
+	}
+
+	auto host_limiters::release(const std::string& host) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto& entry = m_hosts[host];
+		entry.in_flight -= std::min<std::size_t>(entry.in_flight, 1);
+	}
+
+	auto host_limiters::update(const std::string& host, double latency, bool throttled) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_hosts[host].limits.update(latency, throttled);
+	}
+}
+}
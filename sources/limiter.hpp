@@ -0,0 +1,102 @@
+#ifndef __LIMITER_HPP__
+#define __LIMITER_HPP__
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief adaptive limit of requests in flight. The limit doubles every
+    ///     round trip until the first sign of congestion, then grows by one
+    ///     per round trip while latency stays near the lowest seen. It drops
+    ///     by a tenth when latency grows and by half when the api throttles,
+    ///     at most once per round trip. Not thread safe.
+    ///
+    /// Latency is the time from the request sent to the first byte of the
+    /// response, so transfers of different sizes and over new connections
+    /// are comparable. Samples without a latency are not counted.
+    ///
+    class limiter
+    {
+    public:
+
+        ///
+        /// \param maximum limit never exceeded, e.g. the parallelism asked by
+        ///     the caller
+        ///
+        limiter(std::size_t initial, std::size_t maximum);
+
+        auto limit() const -> std::size_t;
+
+        ///
+        /// \brief feeds a finished request.
+        /// \param latency seconds from the request sent to the first byte of
+        ///     the response, 0 if unknown
+        /// \param throttled the api answered 429 or 503
+        ///
+        auto update(double latency, bool throttled) -> void;
+
+    private:
+
+        auto decrease(double factor) -> void;
+
+        double m_limit;
+        double m_maximum;
+        bool m_slow_start = true;
+        double m_min_latency = 0;
+        double m_latency = 0;
+        std::size_t m_since_decrease = 0;
+    };
+
+    ///
+    /// \brief limits of requests in flight to each host, shared by all
+    ///     batches of a context, so batches running side by side do not
+    ///     each take the whole capacity of the api. Safe to use from any
+    ///     thread.
+    ///
+    class host_limiters
+    {
+    public:
+
+        ///
+        /// \brief takes a slot of host if fewer requests than its limit
+        ///     are in flight.
+        ///
+        auto try_acquire(const std::string& host) -> bool;
+
+        ///
+        /// \brief takes a slot of host over its limit, e.g. for the only
+        ///     request of a batch.
+        ///
+        auto acquire(const std::string& host) -> void;
+
+        auto release(const std::string& host) -> void;
+
+        ///
+        /// \brief feeds a finished request to the limiter of host, see
+        ///     limiter::update.
+        ///
+        auto update(const std::string& host, double latency, bool throttled) -> void;
+
+    private:
+
+        struct host_t
+        {
+            host_t();
+
+            limiter limits;
+            std::size_t in_flight = 0;
+        };
+
+        std::mutex m_mutex;
+        std::map<std::string, host_t> m_hosts;
+    };
+}
+}
+
+#endif // __LIMITER_HPP__
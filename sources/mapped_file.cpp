@@ -0,0 +1,54 @@
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "mapped_file.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+#ifndef _WIN32
+	mapped_file::mapped_file(const fs::path& path) {
+		int fd = ::open(path.string().c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("open");
+		}
+		m_size = static_cast<std::size_t>(fs::file_size(path));
+		if (m_size > 0) {
+			auto data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+			if (data == MAP_FAILED) {
+				::close(fd);
+				throw std::runtime_error("mmap");
+			}
+			m_data = static_cast<const char *>(data);
+		}
+		::close(fd);
+	}
+
+	mapped_file::~mapped_file() {
+		if (m_data != nullptr) {
+			::munmap(const_cast<char *>(m_data), m_size);
+		}
+	}
+#else
+	mapped_file::mapped_file(const fs::path& path) {
+		std::ifstream file{path.string(), std::ios::binary};
+		if (not file) {
+			throw std::runtime_error("open");
+		}
+		m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		m_data = m_buffer.data();
+		m_size = m_buffer.size();
+	}
+
+	mapped_file::~mapped_file() {}
+#endif
+}
+}
@@ -0,0 +1,47 @@
+#ifndef __MAPPED_FILE_HPP__
+#define __MAPPED_FILE_HPP__
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief read only view of a whole file: memory mapped on posix
+    ///     systems, read into memory elsewhere.
+    ///
+    class mapped_file
+    {
+    public:
+
+        explicit mapped_file(const fs::path& path);
+
+        mapped_file(const mapped_file&) = delete;
+
+        auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+        ~mapped_file();
+
+        auto data() const -> const char * {
+            return m_data;
+        }
+
+        auto size() const -> std::size_t {
+            return m_size;
+        }
+
+    private:
+
+        const char * m_data = nullptr;
+        std::size_t m_size = 0;
+        std::vector<char> m_buffer;
+    };
+}
+}
+
+#endif // __MAPPED_FILE_HPP__
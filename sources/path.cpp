@@ -12,7 +12,7 @@ namespace url
 
     path::path(std::string str_) : str(str_) {}
 
-    path::path(const char * str_) : str(str_) {}
+    path::path(const char * str_) : str(str_ == nullptr ? "" : str_) {}
 
     void path::swap(path& rhs) {
         std::swap(str, rhs.str);
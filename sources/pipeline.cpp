@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "pipeline.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	ordered_pipeline::ordered_pipeline(transform_t transform, std::size_t workers, std::size_t depth)
+		: m_transform{transform}, m_depth{std::max<std::size_t>(depth, 1)} {
+		for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {
+			m_workers.emplace_back(&ordered_pipeline::work, this);
+		}
+	}
+
+	ordered_pipeline::~ordered_pipeline() {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_stopped = true;
+		}
+		m_changed.notify_all();
+		for (auto& worker : m_workers) {
+			worker.join();
+		}
+	}
+
+	auto ordered_pipeline::push(std::string chunk, bool last) -> bool {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		m_changed.wait(lock, [this]() { return m_failed || m_stopped || m_slots.size() < m_depth; });
+		if (m_failed || m_stopped) {
+			return false;
+		}
+		m_slots.push_back(slot{m_pushed++, last, state::pending, std::move(chunk)});
+		lock.unlock();
+		m_changed.notify_all();
+		return true;
+	}
+
+	auto ordered_pipeline::finish() -> void {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_finished = true;
+		}
+		m_changed.notify_all();
+	}
+
+	auto ordered_pipeline::pop(std::string& chunk) -> bool {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		m_changed.wait(lock, [this]() {
+			return m_failed || m_stopped || (not m_slots.empty() && m_slots.front().status == state::done)
+				|| (m_slots.empty() && m_finished);
+		});
+		if (m_failed || m_stopped || m_slots.empty()) {
+			return false;
+		}
+		chunk = std::move(m_slots.front().data);
+		m_slots.pop_front();
+		lock.unlock();
+		m_changed.notify_all();
+		return true;
+	}
+
+	auto ordered_pipeline::cancel() -> void {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			m_failed = true;
+		}
+		m_changed.notify_all();
+	}
+
+	auto ordered_pipeline::failed() const -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_failed;
+	}
+
+	auto ordered_pipeline::work() -> void {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		for (;;) {
+			auto next = m_slots.end();
+			m_changed.wait(lock, [this, &next]() {
+				next = std::find_if(m_slots.begin(), m_slots.end(), [](const slot& item) { return item.status == state::pending; });
+				return m_stopped || m_failed || next != m_slots.end();
+			});
+			if (m_stopped || m_failed) {
+				return;
+			}
+
+			next->status = state::working;
+			auto index = next->index;
+			auto last = next->last;
+			std::string data = std::move(next->data);
+			lock.unlock();
+			auto ok = m_transform(index, last, data);
+			lock.lock();
+
+			// pushes invalidate iterators while the lock is released, and the
+			// slot is not popped before it is done, so it is found by index
+			auto item = std::find_if(m_slots.begin(), m_slots.end(), [index](const slot& item) { return item.index == index; });
+			if (item != m_slots.end()) {
+				item->data = std::move(data);
+				item->status = state::done;
+			}
+			if (not ok) {
+				m_failed = true;
+			}
+			m_changed.notify_all();
+		}
+	}
+}
+}
@@ -0,0 +1,99 @@
+#ifndef __PIPELINE_HPP__
+#define __PIPELINE_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief transforms chunks on worker threads and hands them over in the
+    ///     order they were pushed. At most depth chunks are held at a time,
+    ///     so a slow consumer stops the producer.
+    ///
+    class ordered_pipeline
+    {
+    public:
+
+        ///
+        /// \brief transforms chunk in place, returns false on failure, which
+        ///     stops the pipeline.
+        ///
+        using transform_t = std::function<bool(std::uint64_t index, bool last, std::string& chunk)>;
+
+        ordered_pipeline(transform_t transform, std::size_t workers, std::size_t depth);
+
+        ordered_pipeline(const ordered_pipeline&) = delete;
+
+        auto operator=(const ordered_pipeline&) -> ordered_pipeline& = delete;
+
+        ~ordered_pipeline();
+
+        ///
+        /// \brief waits for room and queues the next chunk.
+        /// \return false if the pipeline failed or was cancelled
+        ///
+        auto push(std::string chunk, bool last) -> bool;
+
+        ///
+        /// \brief no more chunks will be pushed.
+        ///
+        auto finish() -> void;
+
+        ///
+        /// \brief waits for the next transformed chunk.
+        /// \return false at the end, or if the pipeline failed
+        ///
+        auto pop(std::string& chunk) -> bool;
+
+        ///
+        /// \brief stops the pipeline, e.g. when the producer failed;
+        ///     waiting calls return false.
+        ///
+        auto cancel() -> void;
+
+        auto failed() const -> bool;
+
+    private:
+
+        enum class state
+        {
+            pending,
+            working,
+            done
+        };
+
+        struct slot
+        {
+            std::uint64_t index;
+            bool last;
+            state status;
+            std::string data;
+        };
+
+        auto work() -> void;
+
+        transform_t m_transform;
+        std::size_t m_depth;
+        std::uint64_t m_pushed = 0;
+        bool m_finished = false;
+        bool m_failed = false;
+        bool m_stopped = false;
+        std::deque<slot> m_slots;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::vector<std::thread> m_workers;
+    };
+}
+}
+
+#endif // __PIPELINE_HPP__
@@ -0,0 +1,106 @@
+#include <yadisk/preview_cache.hpp>
+
+#include <cctype>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "batch.hpp"
+#include "context.hpp"
+#include "request.hpp"
+
+namespace yadisk
+{
+	static auto is_md5(const std::string& text) -> bool {
+		if (text.size() != 32) return false;
+		for (auto symbol : text) {
+			if (not std::isxdigit(static_cast<unsigned char>(symbol))) return false;
+		}
+		return true;
+	}
+
+	PreviewCache::PreviewCache(fs::path directory) : m_directory{directory} {}
+
+	auto PreviewCache::path(const json& item, const string& size, bool crop) const -> fs::path {
+		auto md5 = item.find("md5");
+		auto preview = item.find("preview");
+		if (md5 == item.end() || not md5->is_string() || preview == item.end() || not preview->is_string()) {
+			return {};
+		}
+		auto hash = md5->get<std::string>();
+		if (not is_md5(hash)) return {};
+
+		// size is free text, e.g. "M" or "120x80", keep it safe for a file name
+		std::string name = hash + "_";
+		for (auto symbol : size) {
+			name.push_back(std::isalnum(static_cast<unsigned char>(symbol)) ? symbol : '_');
+		}
+		if (crop) name += "_crop";
+		return m_directory / hash.substr(0, 2) / name;
+	}
+
+	auto PreviewCache::fetch(Client& client, const std::vector<json>& items, const string& size, bool crop,
+	                         std::size_t parallelism) -> std::vector<fs::path> {
+		std::vector<fs::path> paths(items.size());
+		// identical files listed several times are fetched once
+		std::map<fs::path, std::vector<std::size_t>> missing;
+		for (std::size_t i = 0; i < items.size(); ++i) {
+			auto cached = path(items[i], size, crop);
+			if (cached.empty()) continue;
+			boost::system::error_code error;
+			if (fs::exists(cached, error)) {
+				paths[i] = cached;
+			}
+			else {
+				missing[cached].push_back(i);
+			}
+		}
+
+		detail::batch batch{*client.m_context, parallelism};
+		auto auth = client.auth_header();
+		for (auto& entry : missing) {
+			auto& cached = entry.first;
+			auto& indexes = entry.second;
+			// previews are small, they are kept in memory until complete, so
+			// no partial file is ever seen in the cache and no file is open
+			// while the request waits in the batch
+			auto content = std::make_shared<std::string>();
+			auto to = std::make_shared<callback_sink>([content](const char * data, std::size_t count) {
+				content->append(data, count);
+				return true;
+			});
+			auto href = items[indexes.front()]["preview"].get<std::string>();
+			auto request = client.fetch_request(href, *to);
+			request->add_header(auth);
+			batch.add(std::move(request), [&paths, &cached, &indexes, content, to](CURLcode code, detail::request& request) {
+				if (code != CURLE_OK || request.http_code() != 200) return;
+
+				boost::system::error_code error;
+				fs::create_directories(cached.parent_path(), error);
+				// a unique name, as other processes may fetch the same preview
+				auto part = cached.parent_path() / fs::unique_path("%%%%%%%%%%%%.part", error);
+				if (error) return;
+				try {
+					file_sink file{part};
+					if (not file.write(content->data(), content->size()) || not file.close()) {
+						throw std::runtime_error("fwrite");
+					}
+				}
+				catch(...) {
+					fs::remove(part, error);
+					return;
+				}
+				fs::rename(part, cached, error);
+				if (error) {
+					fs::remove(part, error);
+					return;
+				}
+				for (auto index : indexes) {
+					paths[index] = cached;
+				}
+			});
+		}
+		batch.run();
+		return paths;
+	}
+}
@@ -27,8 +27,17 @@ auto quote(const url::path& path, CURL * curl) -> std::string {
         auto escape_name = curl_easy_escape(curl, name.c_str(), name.size());
         quote_path.append(url::path::separator);
         quote_path.append(escape_name);
+        curl_free(escape_name);
     });
 
     if (is_directory(path)) quote_path.append(url::path::separator);
     return quote_path;
 }
+
+auto escape(const std::string& text, CURL * curl) -> std::string {
+
+    auto escape_text = curl_easy_escape(curl, text.c_str(), text.size());
+    std::string result = escape_text;
+    curl_free(escape_text);
+    return result;
+}
@@ -0,0 +1,318 @@
+#include <yadisk/remote_file.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "batch.hpp"
+#include "context.hpp"
+#include "request.hpp"
+
+namespace yadisk
+{
+	// total size from the last Content-Range header, "bytes 0-99/1000" or
+	// "bytes */1000"
+	static auto parse_total(const std::string& headers, std::uint64_t& total) -> bool {
+		std::string lower{headers};
+		std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+		auto found = lower.rfind("content-range:");
+		if (found == std::string::npos) return false;
+		auto slash = lower.find('/', found);
+		auto end = lower.find('\n', found);
+		if (slash == std::string::npos || slash > end) return false;
+		try {
+			total = std::stoull(lower.substr(slash + 1, end - slash - 1));
+			return true;
+		}
+		catch (...) {
+			return false;
+		}
+	}
+
+	const std::size_t RemoteFile::max_readahead;
+
+	RemoteFile::RemoteFile(Client client, url::path path, std::size_t block_size, std::size_t capacity)
+		: m_client{client}, m_path{path}, m_block_size{std::max<std::size_t>(block_size, 1)},
+		  m_capacity{capacity} {}
+
+	auto RemoteFile::href(bool renew) -> result<string> {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			if (not renew && not m_href.empty()) return m_href;
+		}
+		auto link = m_client.try_download_link(m_path);
+		if (not link) return link.error();
+		if (not link.value().is_object() || link.value().find("href") == link.value().end()) {
+			error_t error;
+			error.code = errc::parse;
+			return error;
+		}
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_href = link.value()["href"].get<std::string>();
+		return m_href;
+	}
+
+	auto RemoteFile::fetch(std::vector<range_t>& ranges) -> error_t {
+		// the whole file answers a range only from its start, or a suffix
+		// range of size() which takes the start instead
+		auto done = [](const range_t& range) {
+			return range.http_code == 206 || range.http_code == 416
+				|| (range.http_code == 200 && (range.bytes.compare(0, 2, "0-") == 0 || range.bytes[0] == '-'));
+		};
+
+		// download links expire, a refused range gets a new link once
+		for (auto attempt = 0; ; ++attempt) {
+			auto link = href(attempt > 0);
+			if (not link) return link.error();
+
+			detail::batch batch{*m_client.m_context, ranges.size()};
+			std::vector<std::unique_ptr<callback_sink>> sinks;
+			CURLcode transport = CURLE_OK;
+			string redirected;
+			for (auto& range : ranges) {
+				if (done(range)) continue;
+				// a server ignoring the range sends the whole file, only its
+				// start up to the size of the range is taken
+				auto limit = range.bytes[0] == '-' ? std::stoull(range.bytes.substr(1))
+					: std::stoull(range.bytes.substr(range.bytes.find('-') + 1)) - std::stoull(range.bytes) + 1;
+				range.data.clear();
+				range.truncated = false;
+				sinks.emplace_back(new callback_sink{[&range, limit](const char * bytes, std::size_t size) {
+					auto room = static_cast<std::size_t>(limit - range.data.size());
+					range.data.append(bytes, std::min(size, room));
+					range.truncated = size > room;
+					return not range.truncated;
+				}});
+				auto request = m_client.fetch_request(link.value(), *sinks.back());
+				request->add_header("Range: bytes=" + range.bytes);
+				request->keep_headers();
+				batch.add(std::move(request), [&range, &transport, &redirected](CURLcode code, detail::request& request) {
+					// stopping the transfer at the end of the range is not a failure
+					auto answered = code == CURLE_OK || (code == CURLE_WRITE_ERROR && range.truncated);
+					range.http_code = answered ? request.http_code() : 0;
+					range.length = answered ? request.content_length() : -1;
+					range.headers = request.response_headers();
+					if (not answered) {
+						transport = code;
+					}
+					else if (range.http_code == 206) {
+						redirected = request.effective_url();
+					}
+				});
+				m_requests.fetch_add(1, std::memory_order_relaxed);
+			}
+			batch.run();
+
+			// the storage the link redirects to is asked directly from now on
+			if (not redirected.empty()) {
+				std::lock_guard<std::mutex> lock{m_mutex};
+				m_href = redirected;
+			}
+
+			auto expired = false;
+			error_t error;
+			for (auto& range : ranges) {
+				if (done(range)) continue;
+				if (range.http_code == 200) {
+					// the whole file is not what was asked for
+					error.code = errc::api;
+					error.http_code = range.http_code;
+				}
+				else if (range.http_code == 403 || range.http_code == 404 || range.http_code == 410) {
+					expired = true;
+				}
+				else if (range.http_code == 0) {
+					error.code = errc::transport;
+					error.transport = transport;
+				}
+				else {
+					error.code = errc::api;
+					error.http_code = range.http_code;
+				}
+			}
+			if (error.code != errc::ok) return error;
+			if (not expired) return error;
+			if (attempt > 0) {
+				error.code = errc::api;
+				error.http_code = 410;
+				return error;
+			}
+		}
+	}
+
+	auto RemoteFile::size() -> result<std::uint64_t> {
+		std::lock_guard<std::mutex> lock{m_open_mutex};
+		if (m_opened) return m_size;
+
+		// a suffix range returns the last block together with the size
+		std::vector<range_t> ranges(1);
+		ranges[0].bytes = "-" + std::to_string(m_block_size);
+		ranges[0].http_code = 0;
+		ranges[0].length = -1;
+		ranges[0].truncated = false;
+		auto error = fetch(ranges);
+		if (error.code != errc::ok) return error;
+
+		auto& tail = ranges[0];
+		std::uint64_t total = 0;
+		if (tail.http_code == 200 && not tail.truncated) {
+			total = tail.data.size();
+		}
+		else if (tail.http_code == 200 && tail.length >= 0) {
+			total = static_cast<std::uint64_t>(tail.length);
+		}
+		else if (tail.http_code == 200 || not parse_total(tail.headers, total)) {
+			error.code = errc::parse;
+			error.http_code = tail.http_code;
+			return error;
+		}
+
+		if (total > 0 && tail.http_code == 200) {
+			// the range was ignored, the start of the file came instead
+			std::lock_guard<std::mutex> lock{m_mutex};
+			store(0, std::make_shared<const std::string>(tail.data));
+		}
+		else if (total > 0 && tail.http_code != 416) {
+			auto last = (total - 1) / m_block_size;
+			auto length = static_cast<std::size_t>(total - last * m_block_size);
+			if (tail.data.size() >= length) {
+				std::lock_guard<std::mutex> lock{m_mutex};
+				store(last, std::make_shared<const std::string>(tail.data.substr(tail.data.size() - length)));
+			}
+		}
+		m_size = total;
+		m_opened = true;
+		return m_size;
+	}
+
+	auto RemoteFile::fetch(const std::vector<std::uint64_t>& blocks, std::map<std::uint64_t, block_ptr>& fetched) -> error_t {
+		// adjacent blocks go into one range
+		std::vector<std::pair<std::uint64_t, std::uint64_t>> runs;
+		for (auto index : blocks) {
+			if (not runs.empty() && runs.back().second + 1 == index) {
+				runs.back().second = index;
+			}
+			else {
+				runs.emplace_back(index, index);
+			}
+		}
+
+		std::vector<range_t> ranges(runs.size());
+		for (std::size_t i = 0; i < runs.size(); ++i) {
+			auto begin = runs[i].first * m_block_size;
+			auto end = std::min<std::uint64_t>((runs[i].second + 1) * m_block_size, m_size);
+			ranges[i].bytes = std::to_string(begin) + "-" + std::to_string(end - 1);
+			ranges[i].http_code = 0;
+			ranges[i].length = -1;
+			ranges[i].truncated = false;
+		}
+		auto error = fetch(ranges);
+		if (error.code != errc::ok) return error;
+
+		for (std::size_t i = 0; i < runs.size(); ++i) {
+			auto& data = ranges[i].data;
+			std::size_t position = 0;
+			for (auto index = runs[i].first; index <= runs[i].second; ++index) {
+				auto length = static_cast<std::size_t>(std::min<std::uint64_t>(m_block_size, m_size - index * m_block_size));
+				if (data.size() < position + length) {
+					error.code = errc::transport;
+					error.transport = CURLE_PARTIAL_FILE;
+					return error;
+				}
+				fetched[index] = std::make_shared<const std::string>(data.substr(position, length));
+				position += length;
+			}
+		}
+		return error;
+	}
+
+	auto RemoteFile::store(std::uint64_t index, block_ptr block) -> void {
+		auto found = m_blocks.find(index);
+		if (found != m_blocks.end()) {
+			m_lru.erase(found->second);
+		}
+		m_lru.emplace_front(index, block);
+		m_blocks[index] = m_lru.begin();
+		while (m_lru.size() > m_capacity) {
+			m_blocks.erase(m_lru.back().first);
+			m_lru.pop_back();
+		}
+	}
+
+	auto RemoteFile::pread(char * data, std::size_t size, std::uint64_t offset) -> result<std::size_t> {
+		auto total = this->size();
+		if (not total) return total.error();
+		if (size == 0 || offset >= total.value()) return std::size_t{0};
+		size = static_cast<std::size_t>(std::min<std::uint64_t>(size, total.value() - offset));
+
+		auto first = offset / m_block_size;
+		auto last = (offset + size - 1) / m_block_size;
+		std::map<std::uint64_t, block_ptr> pinned;
+
+		std::unique_lock<std::mutex> lock{m_mutex};
+		// readahead is bounded by half of the cache, so it does not evict
+		// the blocks being read
+		auto readahead = std::min<std::size_t>(max_readahead, m_capacity / 2);
+		m_readahead = offset == m_next_offset ? std::min(std::max<std::size_t>(m_readahead * 2, 1), readahead) : 0;
+		m_next_offset = offset + size;
+		auto ahead = std::min<std::uint64_t>(last + m_readahead, (total.value() - 1) / m_block_size);
+
+		for (;;) {
+			std::vector<std::uint64_t> missing;
+			auto waiting = false;
+			for (auto index = first; index <= ahead; ++index) {
+				if (pinned.find(index) != pinned.end()) continue;
+				auto found = m_blocks.find(index);
+				if (found != m_blocks.end()) {
+					m_lru.splice(m_lru.begin(), m_lru, found->second);
+					if (index <= last) pinned[index] = found->second->second;
+				}
+				else if (m_in_flight.find(index) != m_in_flight.end()) {
+					waiting = waiting || index <= last;
+				}
+				else {
+					missing.push_back(index);
+				}
+			}
+			// blocks ahead only join a fetch of blocks being read, so a
+			// sequential reader makes one request per window
+			if (not missing.empty() && missing.front() > last) {
+				missing.clear();
+			}
+			if (missing.empty()) {
+				if (not waiting) break;
+				// another read fetches it, or failed and it is fetched here
+				// on the next round
+				m_fetched.wait(lock);
+				continue;
+			}
+
+			m_in_flight.insert(missing.begin(), missing.end());
+			lock.unlock();
+			std::map<std::uint64_t, block_ptr> fetched;
+			auto error = fetch(missing, fetched);
+			lock.lock();
+			for (auto index : missing) {
+				m_in_flight.erase(index);
+			}
+			for (auto& block : fetched) {
+				store(block.first, block.second);
+				if (block.first >= first && block.first <= last) pinned[block.first] = block.second;
+			}
+			m_fetched.notify_all();
+			if (error.code != errc::ok) return error;
+			// blocks ahead are fetched once, if they are gone already they
+			// are not waited for
+			ahead = last;
+		}
+		lock.unlock();
+
+		for (auto& block : pinned) {
+			auto begin = block.first * m_block_size;
+			auto from = std::max(begin, offset);
+			auto to = std::min<std::uint64_t>(begin + block.second->size(), offset + size);
+			std::memcpy(data + (from - offset), block.second->data() + (from - begin), static_cast<std::size_t>(to - from));
+		}
+		return size;
+	}
+}
@@ -0,0 +1,230 @@
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "request.hpp"
+#include "scheduler.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	request::request(std::string method) : m_method{method} {}
+
+	auto request::set_url(std::string url) -> void {
+		m_url = url;
+	}
+
+	auto request::add_header(const std::string& header) -> void {
+		m_headers.append(header.c_str());
+	}
+
+	auto request::set_body(std::string body) -> void {
+		m_body = body;
+		m_has_body = true;
+	}
+
+	auto request::set_nobody() -> void {
+		m_nobody = true;
+	}
+
+	auto request::set_sink(yadisk::sink& sink) -> void {
+		m_sink = SinkTarget{handle(), &sink, false};
+		set_priority(yadisk::priority::bulk);
+	}
+
+	auto request::set_source(yadisk::source& source) -> void {
+		m_source = &source;
+		set_priority(yadisk::priority::bulk);
+		if (source.size() < 0) {
+			add_header("Transfer-Encoding: chunked");
+		}
+	}
+
+	auto request::set_priority(yadisk::priority level) -> void {
+		m_priority = std::max(m_priority, level);
+	}
+
+	auto request::set_scheduler(scheduler& scheduler) -> void {
+		m_scheduler = &scheduler;
+	}
+
+	auto request::aborted() const -> CURLcode {
+		if (m_cancelled != nullptr && m_cancelled->load()) {
+			return CURLE_ABORTED_BY_CALLBACK;
+		}
+		if (std::chrono::steady_clock::now() >= m_deadline) {
+			return CURLE_OPERATION_TIMEDOUT;
+		}
+		return CURLE_OK;
+	}
+
+	int request::progress(void * userdata, curl_off_t, curl_off_t received, curl_off_t, curl_off_t sent) {
+		auto self = static_cast<request *>(userdata);
+		if (self->m_cancelled != nullptr && self->m_cancelled->load()) {
+			return 1;
+		}
+		if (self->m_scheduler == nullptr) {
+			return 0;
+		}
+		auto now = std::chrono::steady_clock::now();
+		if (self->m_paused) {
+			self->resume(now);
+			return 0;
+		}
+		auto pause = self->m_scheduler->throttle(self->m_priority,
+			static_cast<std::uint64_t>(std::max<curl_off_t>(sent - self->m_sent, 0)),
+			static_cast<std::uint64_t>(std::max<curl_off_t>(received - self->m_received, 0)));
+		self->m_sent = sent;
+		self->m_received = received;
+		// the transfer stops moving data, the thread driving it goes on with
+		// the others
+		if (pause > std::chrono::steady_clock::duration::zero()) {
+			self->m_paused = true;
+			self->m_resume_at = now + pause;
+			curl_easy_pause(self->handle(), CURLPAUSE_ALL);
+		}
+		return 0;
+	}
+
+	auto request::resume(std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::duration {
+		if (not m_paused) {
+			return std::chrono::steady_clock::duration::zero();
+		}
+		if (now < m_resume_at) {
+			return m_resume_at - now;
+		}
+		m_paused = false;
+		curl_easy_pause(handle(), CURLPAUSE_CONT);
+		return std::chrono::steady_clock::duration::zero();
+	}
+
+	auto request::prepare() -> CURL * {
+		CURL * curl = handle();
+		curl_easy_setopt(curl, CURLOPT_URL, m_url.c_str());
+		// a request without a body goes out as HEAD, a custom GET would leave
+		// the body of its answer on the pooled connection
+		if (not m_nobody) {
+			curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, m_method.c_str());
+		}
+		if (m_sink.sink != nullptr) {
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, &m_sink);
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_sink);
+			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+		}
+		else {
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, &m_response);
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write<std::stringstream>);
+		}
+		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0);
+		curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
+		curl_easy_setopt(curl, CURLOPT_HTTPHEADER, m_headers.getCurlSlist());
+		if (m_has_body) {
+			curl_easy_setopt(curl, CURLOPT_POSTFIELDS, m_body.c_str());
+			curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(m_body.size()));
+		}
+		if (m_source != nullptr) {
+			curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+			curl_easy_setopt(curl, CURLOPT_READDATA, m_source);
+			curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_source);
+			if (m_source->size() >= 0) {
+				curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(m_source->size()));
+			}
+		}
+		if (m_nobody) {
+			curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+		}
+		if (m_keep_headers) {
+			curl_easy_setopt(curl, CURLOPT_HEADERDATA, &m_response_headers);
+			curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write<std::stringstream>);
+		}
+		if (m_deadline != std::chrono::steady_clock::time_point::max()) {
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(m_deadline - std::chrono::steady_clock::now());
+			curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 1)));
+		}
+		if (m_stall_timeout > 0) {
+			curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+			curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, m_stall_timeout);
+		}
+		if (m_scheduler != nullptr || m_cancelled != nullptr) {
+			m_sent = m_received = 0;
+			m_paused = false;
+			curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &request::progress);
+			curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+			curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+		}
+		return curl;
+	}
+
+	auto request::rewind() -> bool {
+		if (m_sink.sink != nullptr || m_source != nullptr) {
+			return false;
+		}
+		m_response.str(std::string{});
+		m_response.clear();
+		m_response_headers.str(std::string{});
+		m_response_headers.clear();
+		return true;
+	}
+
+	auto request::duplicate() -> std::unique_ptr<request> {
+		std::unique_ptr<request> copy{new request{m_method}};
+		copy->set_url(m_url);
+		for (auto item = m_headers.getCurlSlist(); item != nullptr; item = item->next) {
+			copy->add_header(item->data);
+		}
+		if (m_has_body) {
+			copy->set_body(m_body);
+		}
+		if (m_nobody) {
+			copy->set_nobody();
+		}
+		copy->m_keep_headers = m_keep_headers;
+		copy->m_priority = m_priority;
+		copy->m_tenant = m_tenant;
+		copy->m_deadline = m_deadline;
+		copy->m_cancelled = m_cancelled;
+		copy->m_stall_timeout = m_stall_timeout;
+		return copy;
+	}
+
+	auto request::headers() -> std::string {
+		std::string lines;
+		for (auto item = m_headers.getCurlSlist(); item != nullptr; item = item->next) {
+			lines += item->data;
+			lines.push_back('\n');
+		}
+		return lines;
+	}
+
+	auto request::effective_url() -> std::string {
+		char * url = nullptr;
+		curl_easy_getinfo(handle(), CURLINFO_EFFECTIVE_URL, &url);
+		return url != nullptr ? url : m_url;
+	}
+
+	auto request::http_code() -> long {
+		if (m_answered_code >= 0) {
+			return m_answered_code;
+		}
+		long http_response_code = 0;
+		curl_easy_getinfo(handle(), CURLINFO_RESPONSE_CODE, &http_response_code);
+		return http_response_code;
+	}
+
+	auto request::content_length() -> std::int64_t {
+		if (m_answered_code >= 0) {
+			return m_answered_length;
+		}
+#if LIBCURL_VERSION_NUM >= 0x073700
+		curl_off_t length = -1;
+		curl_easy_getinfo(handle(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+#else
+		double length = -1;
+		curl_easy_getinfo(handle(), CURLINFO_CONTENT_LENGTH_DOWNLOAD, &length);
+#endif
+		return static_cast<std::int64_t>(length);
+	}
+}
+}
@@ -0,0 +1,325 @@
+#ifndef __REQUEST_HPP__
+#define __REQUEST_HPP__
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include <yadisk/priority.hpp>
+#include <yadisk/sink.hpp>
+#include <yadisk/source.hpp>
+
+#include "callbacks.hpp"
+#include "wrappers.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+    class scheduler;
+    struct tenant;
+
+    ///
+    /// \brief one http exchange with the disk api. Client methods only build
+    ///     requests, so the same request can be performed synchronously or
+    ///     handed over to a curl multi handle.
+    ///
+    class request
+    {
+    public:
+
+        explicit request(std::string method);
+
+        request(const request&) = delete;
+
+        auto operator=(const request&) -> request& = delete;
+
+        auto set_url(std::string url) -> void;
+
+        auto add_header(const std::string& header) -> void;
+
+        auto set_body(std::string body) -> void;
+
+        ///
+        /// \brief sends the request as HEAD, whatever its method.
+        ///
+        auto set_nobody() -> void;
+
+        ///
+        /// \brief streams the response body into sink instead of response(),
+        ///     following redirects as download links do.
+        ///
+        auto set_sink(yadisk::sink& sink) -> void;
+
+        ///
+        /// \brief sends the request body from source, with chunked transfer
+        ///     encoding if its size is not known.
+        ///
+        auto set_source(yadisk::source& source) -> void;
+
+        ///
+        /// \brief raises the class of the request to level, requests with
+        ///     a sink or a source are at least bulk.
+        ///
+        auto set_priority(yadisk::priority level) -> void;
+
+        auto priority() const -> yadisk::priority {
+            return m_priority;
+        }
+
+        ///
+        /// \brief the request fails with CURLE_OPERATION_TIMEDOUT past
+        ///     deadline, in flight or before it starts.
+        ///
+        auto set_deadline(std::chrono::steady_clock::time_point deadline) -> void {
+            m_deadline = deadline;
+        }
+
+        auto deadline() const -> std::chrono::steady_clock::time_point {
+            return m_deadline;
+        }
+
+        ///
+        /// \brief the request is aborted with CURLE_ABORTED_BY_CALLBACK once
+        ///     cancelled is set.
+        ///
+        auto set_cancellation(std::shared_ptr<const std::atomic<bool>> cancelled) -> void {
+            m_cancelled = cancelled;
+        }
+
+        auto cancellable() const -> bool {
+            return m_cancelled != nullptr;
+        }
+
+        ///
+        /// \brief a transfer moving no data for seconds is aborted, 0 waits
+        ///     forever.
+        ///
+        auto set_stall_timeout(long seconds) -> void {
+            m_stall_timeout = seconds;
+        }
+
+        ///
+        /// \brief why the request must not start: CURLE_OPERATION_TIMEDOUT,
+        ///     CURLE_ABORTED_BY_CALLBACK, or CURLE_OK if it may.
+        ///
+        auto aborted() const -> CURLcode;
+
+        ///
+        /// \brief waits on changed until ready() holds, waking up at until
+        ///     to check it again. Cancellation sets a flag nobody notifies,
+        ///     so it is checked at least every 50 ms.
+        /// \return false if the request was aborted first
+        ///
+        template <typename Predicate>
+        auto wait(std::condition_variable& changed, std::unique_lock<std::mutex>& lock,
+                  std::chrono::steady_clock::time_point until, Predicate ready) const -> bool {
+            while (not ready()) {
+                if (aborted() != CURLE_OK) return false;
+                auto wake = std::min(until, m_deadline);
+                if (m_cancelled != nullptr) {
+                    wake = std::min(wake, std::chrono::steady_clock::now() + std::chrono::milliseconds(50));
+                }
+                if (wake == std::chrono::steady_clock::time_point::max()) {
+                    changed.wait(lock);
+                }
+                else {
+                    changed.wait_until(lock, wake);
+                }
+            }
+            return true;
+        }
+
+        ///
+        /// \brief the account of a ClientPool the request is made for,
+        ///     nullptr outside of a pool.
+        ///
+        auto set_tenant(std::shared_ptr<detail::tenant> tenant) -> void {
+            m_tenant = tenant;
+        }
+
+        auto tenant() const -> detail::tenant * {
+            return m_tenant.get();
+        }
+
+        ///
+        /// \brief reports the progress of the transfer to scheduler. A
+        ///     transfer which gets ahead of the bandwidth of its class is
+        ///     paused with curl_easy_pause, nothing sleeps in a callback.
+        ///
+        auto set_scheduler(scheduler& scheduler) -> void;
+
+        ///
+        /// \brief continues a transfer paused by the scheduler once its
+        ///     pause is over; loops driving a multi handle call it for their
+        ///     transfers, a transfer performed alone is resumed by itself.
+        /// \return how long the transfer stays paused, zero if it runs
+        ///
+        auto resume(std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::duration;
+
+        ///
+        /// \brief easy handle of the request, it can be used for escaping
+        ///     before the request is prepared.
+        ///
+        auto handle() -> CURL * {
+            return m_curl.getCurl();
+        }
+
+        ///
+        /// \brief applies url, method, headers, body and response writer to
+        ///     the easy handle; must be called before the handle is performed.
+        ///
+        auto prepare() -> CURL *;
+
+        ///
+        /// \brief forgets the response so the request can be performed
+        ///     again.
+        /// \return false if the request streams its body to a sink or from
+        ///     a source, which can not be replayed
+        ///
+        auto rewind() -> bool;
+
+        ///
+        /// \brief the request headers, one per line.
+        ///
+        auto headers() -> std::string;
+
+        auto body() const -> const std::string& {
+            return m_body;
+        }
+
+        auto sink() const -> yadisk::sink * {
+            return m_sink.sink;
+        }
+
+        auto source() const -> yadisk::source * {
+            return m_source;
+        }
+
+        ///
+        /// \brief whether the response goes to a sink instead of response().
+        ///
+        auto streamed() const -> bool {
+            return m_sink.sink != nullptr;
+        }
+
+        ///
+        /// \brief marks the request as answered with http_code without a
+        ///     transfer of its own, from a transcript or by a hedge.
+        /// \param length is the announced length of the answer, -1 if unknown
+        ///
+        auto set_answered(long http_code, std::int64_t length = -1) -> void {
+            m_answered_code = http_code;
+            m_answered_length = length;
+        }
+
+        ///
+        /// \brief lets a GET without a sink be sent once more when it is
+        ///     slower than percentile of recent ones, see hedger.
+        ///
+        auto set_hedging(double percentile, double budget) -> void {
+            m_hedge_percentile = percentile;
+            m_hedge_budget = budget;
+        }
+
+        auto hedge_percentile() const -> double {
+            return m_hedge_percentile;
+        }
+
+        auto hedge_budget() const -> double {
+            return m_hedge_budget;
+        }
+
+        ///
+        /// \brief whether the request may be sent twice: a GET without a
+        ///     sink or a source, with hedging set.
+        ///
+        auto hedged() const -> bool {
+            return m_hedge_percentile > 0 && m_method == "GET" && m_sink.sink == nullptr && m_source == nullptr;
+        }
+
+        ///
+        /// \brief a copy of the request to send along with it, hedged()
+        ///     requests only.
+        ///
+        auto duplicate() -> std::unique_ptr<request>;
+
+        ///
+        /// \brief keeps the response headers, of redirects too, for
+        ///     response_headers().
+        ///
+        auto keep_headers() -> void {
+            m_keep_headers = true;
+        }
+
+        auto response_headers() const -> std::string {
+            return m_response_headers.str();
+        }
+
+        ///
+        /// \brief url of the last response, after redirects.
+        ///
+        auto effective_url() -> std::string;
+
+        auto response() -> std::stringstream& {
+            return m_response;
+        }
+
+        auto http_code() -> long;
+
+        ///
+        /// \brief length of the answer from its Content-Length, -1 if unknown.
+        ///
+        auto content_length() -> std::int64_t;
+
+        auto method() const -> const std::string& {
+            return m_method;
+        }
+
+        auto url() const -> const std::string& {
+            return m_url;
+        }
+
+    private:
+
+        static int progress(void * userdata, curl_off_t, curl_off_t received, curl_off_t, curl_off_t sent);
+
+        CurlWrapper m_curl;
+        CurlSlistWrapper m_headers;
+        std::string m_method;
+        std::string m_url;
+        std::string m_body;
+        bool m_has_body = false;
+        bool m_nobody = false;
+        bool m_keep_headers = false;
+        SinkTarget m_sink{nullptr, nullptr, false};
+        yadisk::source * m_source = nullptr;
+        yadisk::priority m_priority = yadisk::priority::interactive;
+        scheduler * m_scheduler = nullptr;
+        std::shared_ptr<detail::tenant> m_tenant;
+        std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max();
+        std::shared_ptr<const std::atomic<bool>> m_cancelled;
+        long m_stall_timeout = 0;
+        curl_off_t m_sent = 0;
+        curl_off_t m_received = 0;
+        bool m_paused = false;
+        std::chrono::steady_clock::time_point m_resume_at;
+        long m_answered_code = -1;
+        std::int64_t m_answered_length = -1;
+        double m_hedge_percentile = 0;
+        double m_hedge_budget = 0;
+        std::stringstream m_response;
+        std::stringstream m_response_headers;
+    };
+}
+}
+
+#endif // __REQUEST_HPP__
@@ -0,0 +1,261 @@
+#include <yadisk/scanner.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace yadisk
+{
+	using entries_t = std::vector<Scanner::entry_t>;
+
+	// directories waiting to be listed by a thread, taken from the back by
+	// their owner and from the front by the others
+	struct work_queue
+	{
+		std::mutex mutex;
+		std::deque<fs::path> directories;
+	};
+
+	struct scan_state
+	{
+		explicit scan_state(std::size_t threads) : queues(threads) {
+			for (auto& queue : queues) queue.reset(new work_queue);
+		}
+
+		std::vector<std::unique_ptr<work_queue>> queues;
+		// directories queued or being listed, the walk is over at zero
+		std::atomic<std::size_t> pending{0};
+		std::atomic<bool> stopped{false};
+		std::atomic<bool> incomplete{false};
+
+		std::mutex idle_mutex;
+		std::condition_variable work_added;
+
+		std::mutex output_mutex;
+		std::condition_variable output_changed;
+		std::deque<entries_t> output;
+		std::size_t running = 0;
+	};
+
+	// entries of a worker sent in batches, bounded so that a slow visitor
+	// holds the walk back instead of collecting the whole tree in memory
+	static const std::size_t batch_size = 256;
+
+	static auto flush(scan_state& state, entries_t& batch, std::size_t max_batches) -> void {
+		if (batch.empty()) return;
+		std::unique_lock<std::mutex> lock{state.output_mutex};
+		state.output_changed.wait(lock, [&state, max_batches]() {
+			return state.output.size() < max_batches || state.stopped.load();
+		});
+		state.output.push_back(std::move(batch));
+		batch.clear();
+		state.output_changed.notify_all();
+	}
+
+	static auto take(scan_state& state, std::size_t self, fs::path& directory) -> bool {
+		{
+			auto& own = *state.queues[self];
+			std::lock_guard<std::mutex> lock{own.mutex};
+			if (not own.directories.empty()) {
+				directory = std::move(own.directories.back());
+				own.directories.pop_back();
+				return true;
+			}
+		}
+		for (std::size_t i = 1; i < state.queues.size(); ++i) {
+			auto& other = *state.queues[(self + i) % state.queues.size()];
+			std::lock_guard<std::mutex> lock{other.mutex};
+			if (not other.directories.empty()) {
+				directory = std::move(other.directories.front());
+				other.directories.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+#ifndef _WIN32
+	// Lists directory with the names resolved relative to its descriptor.
+	static auto list(const fs::path& directory, entries_t& batch, std::vector<fs::path>& subdirectories) -> bool {
+		int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) return false;
+		auto dir = ::fdopendir(fd);
+		if (dir == nullptr) {
+			::close(fd);
+			return false;
+		}
+		while (auto item = ::readdir(dir)) {
+			auto name = item->d_name;
+			if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+			// the type from the directory itself spares a stat of the rest
+			if (item->d_type != DT_UNKNOWN && item->d_type != DT_REG && item->d_type != DT_DIR) continue;
+#endif
+			struct stat status;
+			if (::fstatat(fd, name, &status, AT_SYMLINK_NOFOLLOW) != 0) continue;
+			auto is_directory = S_ISDIR(status.st_mode);
+			if (not is_directory && not S_ISREG(status.st_mode)) continue;
+
+			Scanner::entry_t entry;
+			entry.path = directory / name;
+			entry.size = is_directory ? 0 : static_cast<std::uint64_t>(status.st_size);
+			entry.modified = static_cast<std::int64_t>(status.st_mtime);
+			entry.inode = static_cast<std::uint64_t>(status.st_ino);
+			entry.directory = is_directory;
+			if (is_directory) subdirectories.push_back(entry.path);
+			batch.push_back(std::move(entry));
+		}
+		::closedir(dir);
+		return true;
+	}
+#else
+	static auto list(const fs::path& directory, entries_t& batch, std::vector<fs::path>& subdirectories) -> bool {
+		boost::system::error_code error;
+		for (fs::directory_iterator it{directory, error}, end; not error && it != end; it.increment(error)) {
+			boost::system::error_code ignored;
+			auto status = it->symlink_status(ignored);
+			auto is_directory = fs::is_directory(status);
+			if (not is_directory && not fs::is_regular_file(status)) continue;
+
+			Scanner::entry_t entry;
+			entry.path = it->path();
+			entry.size = is_directory ? 0 : static_cast<std::uint64_t>(fs::file_size(entry.path, ignored));
+			entry.modified = static_cast<std::int64_t>(fs::last_write_time(entry.path, ignored));
+			entry.inode = 0;
+			entry.directory = is_directory;
+			if (is_directory) subdirectories.push_back(entry.path);
+			batch.push_back(std::move(entry));
+		}
+		return not error;
+	}
+#endif
+
+	static auto work(scan_state& state, std::size_t self, std::size_t max_batches) -> void {
+		entries_t batch;
+		std::vector<fs::path> subdirectories;
+		fs::path directory;
+		while (not state.stopped.load()) {
+			if (not take(state, self, directory)) {
+				// nothing to steal: send what was found and wait for
+				// directories of others or the end of the walk
+				flush(state, batch, max_batches);
+				std::unique_lock<std::mutex> lock{state.idle_mutex};
+				if (state.pending.load() == 0) break;
+				state.work_added.wait_for(lock, std::chrono::milliseconds(10));
+				continue;
+			}
+
+			subdirectories.clear();
+			if (not list(directory, batch, subdirectories)) {
+				state.incomplete.store(true);
+			}
+			if (not subdirectories.empty()) {
+				// a directory is sent before anything below it is listed
+				flush(state, batch, max_batches);
+				state.pending.fetch_add(subdirectories.size());
+				{
+					auto& own = *state.queues[self];
+					std::lock_guard<std::mutex> lock{own.mutex};
+					for (auto& subdirectory : subdirectories) {
+						own.directories.push_back(std::move(subdirectory));
+					}
+				}
+				std::lock_guard<std::mutex> lock{state.idle_mutex};
+				state.work_added.notify_all();
+			}
+			else if (batch.size() >= batch_size) {
+				flush(state, batch, max_batches);
+			}
+
+			if (state.pending.fetch_sub(1) == 1) {
+				std::lock_guard<std::mutex> lock{state.idle_mutex};
+				state.work_added.notify_all();
+			}
+		}
+		flush(state, batch, max_batches);
+
+		std::lock_guard<std::mutex> lock{state.output_mutex};
+		--state.running;
+		state.output_changed.notify_all();
+	}
+
+	Scanner::Scanner(std::size_t threads) : m_threads{std::max<std::size_t>(threads, 1)} {}
+
+	auto Scanner::scan(fs::path root, std::function<bool(const entry_t& entry)> visit) -> bool {
+		boost::system::error_code error;
+		if (not fs::is_directory(root, error)) return false;
+
+		scan_state state{m_threads};
+		auto max_batches = m_threads * 4;
+		state.queues[0]->directories.push_back(root);
+		state.pending.store(1);
+		state.running = m_threads;
+
+		std::vector<std::thread> workers;
+		auto completed = true;
+		{
+			// workers are stopped and joined on every way out, also when
+			// visit or starting a thread throws
+			struct scope
+			{
+				scope(scan_state& state, std::vector<std::thread>& workers) : state(state), workers(workers) {}
+				~scope() {
+					{
+						std::lock_guard<std::mutex> lock{state.output_mutex};
+						state.stopped.store(true);
+						state.output_changed.notify_all();
+					}
+					{
+						std::lock_guard<std::mutex> lock{state.idle_mutex};
+						state.work_added.notify_all();
+					}
+					for (auto& worker : workers) {
+						if (worker.joinable()) worker.join();
+					}
+				}
+				scan_state& state;
+				std::vector<std::thread>& workers;
+			} joining{state, workers};
+
+			for (std::size_t i = 0; i < m_threads; ++i) {
+				workers.emplace_back(work, std::ref(state), i, max_batches);
+			}
+
+			for (;;) {
+				entries_t batch;
+				{
+					std::unique_lock<std::mutex> lock{state.output_mutex};
+					state.output_changed.wait(lock, [&state]() {
+						return not state.output.empty() || state.running == 0;
+					});
+					if (state.output.empty()) break;
+					batch = std::move(state.output.front());
+					state.output.pop_front();
+					state.output_changed.notify_all();
+				}
+				for (auto& entry : batch) {
+					if (not visit(entry)) {
+						completed = false;
+						break;
+					}
+				}
+				if (not completed) break;
+			}
+		}
+		return completed && not state.incomplete.load();
+	}
+}
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include "request.hpp"
+#include "scheduler.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	auto token_bucket::set_rate(std::uint64_t rate) -> void {
+		m_rate = rate;
+		m_tokens = static_cast<double>(rate);
+		m_updated = std::chrono::steady_clock::now();
+	}
+
+	auto token_bucket::take(std::uint64_t bytes, std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::duration {
+		if (m_rate == 0) {
+			return std::chrono::steady_clock::duration::zero();
+		}
+		auto elapsed = std::chrono::duration<double>(now - m_updated).count();
+		m_updated = now;
+		m_tokens = std::min(static_cast<double>(m_rate), m_tokens + elapsed * m_rate);
+		m_tokens -= static_cast<double>(bytes);
+		if (m_tokens >= 0) {
+			return std::chrono::steady_clock::duration::zero();
+		}
+		return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(-m_tokens / m_rate));
+	}
+
+	auto scheduler::set_limits(priority level, std::size_t connections, std::uint64_t send_rate, std::uint64_t receive_rate) -> void {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			auto& lane = m_lanes[static_cast<std::size_t>(level)];
+			lane.connections = connections;
+			lane.send.set_rate(send_rate);
+			lane.receive.set_rate(receive_rate);
+		}
+		m_released.notify_all();
+	}
+
+	auto scheduler::set_bandwidth(std::uint64_t send_rate, std::uint64_t receive_rate) -> void {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_send.set_rate(send_rate);
+		m_receive.set_rate(receive_rate);
+	}
+
+	auto scheduler::acquire(priority level, const request& request) -> bool {
+		std::unique_lock<std::mutex> lock{m_mutex};
+		auto& lane = m_lanes[static_cast<std::size_t>(level)];
+		auto max = std::chrono::steady_clock::time_point::max();
+		if (not request.wait(m_released, lock, max, [this, &lane]() { return available(lane); })) {
+			return false;
+		}
+		++lane.active;
+		return true;
+	}
+
+	auto scheduler::try_acquire(priority level) -> bool {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto& lane = m_lanes[static_cast<std::size_t>(level)];
+		if (not available(lane)) {
+			return false;
+		}
+		++lane.active;
+		return true;
+	}
+
+	auto scheduler::release(priority level) -> void {
+		{
+			std::lock_guard<std::mutex> lock{m_mutex};
+			--m_lanes[static_cast<std::size_t>(level)].active;
+		}
+		m_released.notify_all();
+	}
+
+	auto scheduler::throttle(priority level, std::uint64_t sent, std::uint64_t received) -> std::chrono::steady_clock::duration {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto now = std::chrono::steady_clock::now();
+		auto& lane = m_lanes[static_cast<std::size_t>(level)];
+		auto pause = std::max(lane.send.take(sent, now), lane.receive.take(received, now));
+		auto global = std::max(m_send.take(sent, now), m_receive.take(received, now));
+		if (level != priority::interactive) {
+			pause = std::max(pause, global);
+		}
+		return pause;
+	}
+}
+}
@@ -0,0 +1,101 @@
+#ifndef __SCHEDULER_HPP__
+#define __SCHEDULER_HPP__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <yadisk/priority.hpp>
+
+namespace yadisk
+{
+namespace detail
+{
+    class request;
+
+    ///
+    /// \brief token bucket refilled at rate bytes per second with a burst
+    ///     of one second; rate 0 means unlimited. Not thread safe.
+    ///
+    class token_bucket
+    {
+    public:
+
+        auto set_rate(std::uint64_t rate) -> void;
+
+        ///
+        /// \brief takes bytes from the bucket, going into debt if needed.
+        /// \return how long the transfer has to wait for the debt to be repaid
+        ///
+        auto take(std::uint64_t bytes, std::chrono::steady_clock::time_point now) -> std::chrono::steady_clock::duration;
+
+    private:
+
+        std::uint64_t m_rate = 0;
+        double m_tokens = 0;
+        std::chrono::steady_clock::time_point m_updated;
+    };
+
+    ///
+    /// \brief connection budgets and bandwidth caps of priority classes,
+    ///     shared by all copies of a client.
+    ///
+    /// Connections limit how many transfers of a class run at a time, 0 is
+    /// unlimited. Bandwidth is shaped by pausing a transfer which got ahead
+    /// of the cap of its class or of the global cap; interactive transfers
+    /// are counted against the global cap but never wait for it, so bulk
+    /// traffic can not delay them.
+    ///
+    class scheduler
+    {
+    public:
+
+        auto set_limits(priority level, std::size_t connections, std::uint64_t send_rate, std::uint64_t receive_rate) -> void;
+
+        auto set_bandwidth(std::uint64_t send_rate, std::uint64_t receive_rate) -> void;
+
+        ///
+        /// \brief waits for a free connection of the class, as long as
+        ///     request is neither cancelled nor past its deadline.
+        /// \return false if request was aborted first
+        ///
+        auto acquire(priority level, const request& request) -> bool;
+
+        auto try_acquire(priority level) -> bool;
+
+        auto release(priority level) -> void;
+
+        ///
+        /// \brief accounts bytes moved by a transfer of the class.
+        /// \return how long the transfer has to pause
+        ///
+        auto throttle(priority level, std::uint64_t sent, std::uint64_t received) -> std::chrono::steady_clock::duration;
+
+    private:
+
+        struct lane
+        {
+            std::size_t connections = 0;
+            std::size_t active = 0;
+            token_bucket send;
+            token_bucket receive;
+        };
+
+        static const std::size_t lanes = 3;
+
+        auto available(const lane& lane) const -> bool {
+            return lane.connections == 0 || lane.active < lane.connections;
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_released;
+        lane m_lanes[lanes];
+        token_bucket m_send;
+        token_bucket m_receive;
+    };
+}
+}
+
+#endif // __SCHEDULER_HPP__
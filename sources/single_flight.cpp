@@ -0,0 +1,45 @@
+#include "single_flight.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	auto single_flight::run(const std::string& key, const std::function<result()>& call) -> result_ptr {
+		std::promise<result_ptr> promise;
+		std::unique_lock<std::mutex> lock{m_mutex};
+		auto found = m_calls.find(key);
+		if (found != m_calls.end()) {
+			++m_coalesced;
+			auto future = found->second;
+			lock.unlock();
+			return future.get();
+		}
+		m_calls.emplace(key, promise.get_future().share());
+		lock.unlock();
+
+		// the call is removed before waiters are woken up, so a caller coming
+		// after the result is ready starts a new request instead of reading
+		// a stale one
+		auto finish = [this, &key]() {
+			std::lock_guard<std::mutex> guard{m_mutex};
+			m_calls.erase(key);
+		};
+		try {
+			auto value = std::make_shared<const result>(call());
+			finish();
+			promise.set_value(value);
+			return value;
+		}
+		catch(...) {
+			finish();
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+	}
+
+	auto single_flight::coalesced() const -> std::uint64_t {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		return m_coalesced;
+	}
+}
+}
@@ -0,0 +1,57 @@
+#ifndef __SINGLE_FLIGHT_HPP__
+#define __SINGLE_FLIGHT_HPP__
+
+#include <curl/curl.h>
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief coalesces identical calls made at the same time: the first
+    ///     caller for a key performs the call, callers arriving while it is
+    ///     in flight wait for it and get the same result. Nothing is cached,
+    ///     a call made after the previous one finished runs again.
+    ///
+    class single_flight
+    {
+    public:
+
+        struct result
+        {
+            CURLcode code;
+            long http_code;
+            std::string body;
+        };
+
+        using result_ptr = std::shared_ptr<const result>;
+
+        ///
+        /// \brief performs call unless a call with the same key is in flight.
+        ///     An exception thrown by call is rethrown to every waiter.
+        ///
+        auto run(const std::string& key, const std::function<result()>& call) -> result_ptr;
+
+        ///
+        /// \return number of calls answered by another caller's request.
+        ///
+        auto coalesced() const -> std::uint64_t;
+
+    private:
+
+        mutable std::mutex m_mutex;
+        std::map<std::string, std::shared_future<result_ptr>> m_calls;
+        std::uint64_t m_coalesced = 0;
+    };
+}
+}
+
+#endif // __SINGLE_FLIGHT_HPP__
@@ -0,0 +1,124 @@
+#include <yadisk/sink.hpp>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace yadisk
+{
+	auto buffer_sink::write(const char * data, std::size_t size) -> bool {
+		if (size > m_capacity - m_size) return false;
+		std::memcpy(m_data + m_size, data, size);
+		m_size += size;
+		return true;
+	}
+
+	auto stream_sink::write(const char * data, std::size_t size) -> bool {
+		m_stream.write(data, size);
+		return not m_stream.fail();
+	}
+
+	file_sink::file_sink(fs::path path) : m_file{std::fopen(path.string().c_str(), "wb")} {
+		if (m_file == nullptr) {
+			throw std::runtime_error("fopen");
+		}
+	}
+
+	file_sink::~file_sink() {
+		close();
+	}
+
+	auto file_sink::write(const char * data, std::size_t size) -> bool {
+		return m_file != nullptr && std::fwrite(data, 1, size, m_file) == size;
+	}
+
+	auto file_sink::close() -> bool {
+		if (m_file == nullptr) return true;
+		// buffered data reaches the file only here, a full disk shows up late
+		auto closed = std::fclose(m_file) == 0;
+		m_file = nullptr;
+		return closed;
+	}
+
+#ifndef _WIN32
+	mapped_file_sink::mapped_file_sink(fs::path path)
+		: m_fd{::open(path.string().c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)} {
+		if (m_fd < 0) {
+			throw std::runtime_error("open");
+		}
+	}
+
+	mapped_file_sink::~mapped_file_sink() {
+		close();
+	}
+
+	auto mapped_file_sink::reserve(std::uint64_t size) -> void {
+		if (size > m_capacity) remap(static_cast<std::size_t>(size));
+	}
+
+	auto mapped_file_sink::remap(std::size_t capacity) -> bool {
+		if (m_data != nullptr) {
+			::munmap(m_data, m_capacity);
+			m_data = nullptr;
+		}
+		if (::ftruncate(m_fd, static_cast<off_t>(capacity)) != 0) return false;
+		auto data = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+		if (data == MAP_FAILED) return false;
+		m_data = static_cast<char *>(data);
+		m_capacity = capacity;
+		return true;
+	}
+
+	auto mapped_file_sink::write(const char * data, std::size_t size) -> bool {
+		if (m_fd < 0) return false;
+		if (m_size + size > m_capacity) {
+			std::size_t capacity = m_capacity == 0 ? 1 << 20 : m_capacity;
+			while (capacity < m_size + size) capacity *= 2;
+			if (not remap(capacity)) return false;
+		}
+		std::memcpy(m_data + m_size, data, size);
+		m_size += size;
+		return true;
+	}
+
+	auto mapped_file_sink::close() -> bool {
+		if (m_fd < 0) return true;
+		if (m_data != nullptr) {
+			::munmap(m_data, m_capacity);
+			m_data = nullptr;
+		}
+		// the descriptor is closed even if trimming fails
+		auto trimmed = ::ftruncate(m_fd, static_cast<off_t>(m_size)) == 0;
+		auto closed = ::close(m_fd) == 0;
+		m_fd = -1;
+		return trimmed && closed;
+	}
+
+	auto fd_sink::write(const char * data, std::size_t size) -> bool {
+		while (size > 0) {
+			auto written = ::write(m_fd, data, size);
+			if (written < 0) {
+				if (errno == EINTR) continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+				// the wait is cut into slices, a cancelled transfer stops
+				// waiting for a reader which may never come
+				if (m_cancelled.cancelled()) return false;
+				pollfd item{m_fd, POLLOUT, 0};
+				if (::poll(&item, 1, 100) < 0 && errno != EINTR) return false;
+				continue;
+			}
+			data += written;
+			size -= static_cast<std::size_t>(written);
+		}
+		return true;
+	}
+#endif
+}
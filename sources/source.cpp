@@ -0,0 +1,105 @@
+#include <yadisk/source.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace yadisk
+{
+	const std::size_t source::abort;
+
+	auto stream_source::read(char * data, std::size_t size) -> std::size_t {
+		m_stream.read(data, size);
+		if (m_stream.bad()) return source::abort;
+		return static_cast<std::size_t>(m_stream.gcount());
+	}
+
+	file_source::file_source(fs::path path)
+		: m_file{std::fopen(path.string().c_str(), "rb")},
+		  m_size{static_cast<std::int64_t>(fs::file_size(path))} {
+		if (m_file == nullptr) {
+			throw std::runtime_error("fopen");
+		}
+	}
+
+	file_source::~file_source() {
+		std::fclose(m_file);
+	}
+
+	auto file_source::read(char * data, std::size_t size) -> std::size_t {
+		auto count = std::fread(data, 1, size, m_file);
+		if (count == 0 && std::ferror(m_file)) return source::abort;
+		return count;
+	}
+
+	buffered_source::buffered_source(source& upstream, std::size_t capacity)
+		: m_upstream(upstream), m_buffer(std::max<std::size_t>(capacity, 1)) {}
+
+	buffered_source::~buffered_source() {
+		if (not m_producer.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cancelled = true;
+		}
+		m_writable.notify_all();
+		m_producer.join();
+	}
+
+	auto buffered_source::produce() -> void {
+		const auto capacity = m_buffer.size();
+		for (;;) {
+			std::size_t tail = 0, room = 0;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_writable.wait(lock, [this, capacity]() { return m_cancelled || m_filled < capacity; });
+				if (m_cancelled) return;
+				tail = (m_head + m_filled) % capacity;
+				room = std::min(capacity - m_filled, capacity - tail);
+			}
+
+			// the free region belongs to the producer until it is published
+			auto count = m_upstream.read(m_buffer.data() + tail, room);
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (count == source::abort) {
+					m_failed = true;
+				}
+				else if (count == 0) {
+					m_finished = true;
+				}
+				else {
+					m_filled += count;
+				}
+			}
+			m_readable.notify_one();
+			if (count == 0 || count == source::abort) return;
+		}
+	}
+
+	auto buffered_source::read(char * data, std::size_t size) -> std::size_t {
+		if (not m_producer.joinable()) {
+			m_producer = std::thread(&buffered_source::produce, this);
+		}
+		const auto capacity = m_buffer.size();
+		std::size_t head = 0, count = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_readable.wait(lock, [this]() { return m_filled > 0 || m_finished || m_failed; });
+			if (m_failed) return source::abort;
+			if (m_filled == 0) return 0;
+			head = m_head;
+			count = std::min(size, std::min(m_filled, capacity - head));
+		}
+
+		std::memcpy(data, m_buffer.data() + head, count);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_head = (m_head + count) % capacity;
+			m_filled -= count;
+		}
+		m_writable.notify_one();
+		return count;
+	}
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "transcript.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+	static const char transcript_magic[4] = {'Y', 'D', 'T', 'R'};
+	static const std::uint32_t transcript_version = 1;
+
+	static auto put(std::string& out, std::uint64_t value, std::size_t bytes) -> void {
+		for (std::size_t i = 0; i < bytes; ++i) {
+			out.push_back(static_cast<char>(value >> (8 * i)));
+		}
+	}
+
+	static auto put(std::string& out, const std::string& text) -> void {
+		put(out, text.size(), 4);
+		out += text;
+	}
+
+	// reads fields of a record from a transcript file, false at its end
+	class transcript_reader
+	{
+	public:
+
+		explicit transcript_reader(std::FILE * file) : m_file{file} {}
+
+		auto integer(std::uint64_t& value, std::size_t bytes) -> bool {
+			unsigned char data[8];
+			if (std::fread(data, 1, bytes, m_file) != bytes) return false;
+			value = 0;
+			for (std::size_t i = 0; i < bytes; ++i) {
+				value |= static_cast<std::uint64_t>(data[i]) << (8 * i);
+			}
+			return true;
+		}
+
+		auto text(std::string& value) -> bool {
+			std::uint64_t size = 0;
+			if (not integer(size, 4)) return false;
+			value.resize(static_cast<std::size_t>(size));
+			return size == 0 || std::fread(&value[0], 1, value.size(), m_file) == value.size();
+		}
+
+	private:
+
+		std::FILE * m_file;
+	};
+
+	static auto redact(const std::string& headers) -> std::string {
+		static const std::string authorization = "Authorization:";
+		std::string result;
+		std::size_t start = 0;
+		while (start < headers.size()) {
+			auto end = headers.find('\n', start);
+			if (end == std::string::npos) end = headers.size();
+			auto line = headers.substr(start, end - start);
+			result += line.compare(0, authorization.size(), authorization) == 0 ? authorization + " <redacted>" : line;
+			result.push_back('\n');
+			start = end + 1;
+		}
+		return result;
+	}
+
+	static auto key(const std::string& method, const std::string& url) -> std::string {
+		return method + " " + url;
+	}
+
+	recorder::recorder(const fs::path& path)
+		: m_file{std::fopen(path.string().c_str(), "wb")}, m_started{std::chrono::steady_clock::now()} {
+		if (m_file == nullptr) {
+			throw std::runtime_error("fopen");
+		}
+		std::string header{transcript_magic, sizeof(transcript_magic)};
+		put(header, transcript_version, 4);
+		std::fwrite(header.data(), 1, header.size(), m_file);
+	}
+
+	recorder::~recorder() {
+		std::fclose(m_file);
+	}
+
+	auto recorder::elapsed() const -> std::uint64_t {
+		auto elapsed = std::chrono::steady_clock::now() - m_started;
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	}
+
+	auto recorder::record(request& request, CURLcode code, std::uint64_t start, std::uint64_t duration) -> void {
+#if LIBCURL_VERSION_NUM >= 0x073700
+		curl_off_t sent = 0, received = 0;
+		curl_easy_getinfo(request.handle(), CURLINFO_SIZE_UPLOAD_T, &sent);
+		curl_easy_getinfo(request.handle(), CURLINFO_SIZE_DOWNLOAD_T, &received);
+#else
+		double sent = 0, received = 0;
+		curl_easy_getinfo(request.handle(), CURLINFO_SIZE_UPLOAD, &sent);
+		curl_easy_getinfo(request.handle(), CURLINFO_SIZE_DOWNLOAD, &received);
+#endif
+		auto streamed = request.streamed();
+		std::string record;
+		put(record, start, 8);
+		put(record, duration, 8);
+		put(record, static_cast<std::uint64_t>(sent), 8);
+		put(record, static_cast<std::uint64_t>(received), 8);
+		put(record, static_cast<std::uint32_t>(code), 4);
+		put(record, static_cast<std::uint32_t>(code == CURLE_OK ? request.http_code() : 0), 4);
+		put(record, streamed ? 1 : 0, 1);
+		put(record, request.method());
+		put(record, request.url());
+		put(record, redact(request.headers()));
+		put(record, request.body());
+		put(record, streamed ? std::string{} : request.response().str());
+
+		std::lock_guard<std::mutex> lock{m_mutex};
+		std::fwrite(record.data(), 1, record.size(), m_file);
+		std::fflush(m_file);
+	}
+
+	player::player(const fs::path& path, double time_scale) : m_time_scale{std::max(time_scale, 0.0)} {
+		std::unique_ptr<std::FILE, int (*)(std::FILE *)> file{std::fopen(path.string().c_str(), "rb"), &std::fclose};
+		if (file == nullptr) {
+			throw std::runtime_error("fopen");
+		}
+		char magic[sizeof(transcript_magic)];
+		transcript_reader reader{file.get()};
+		std::uint64_t version = 0;
+		if (std::fread(magic, 1, sizeof(magic), file.get()) != sizeof(magic)
+			|| not std::equal(magic, magic + sizeof(magic), transcript_magic)
+			|| not reader.integer(version, 4) || version != transcript_version) {
+			throw std::runtime_error("not a transcript");
+		}
+
+		for (;;) {
+			exchange item;
+			std::uint64_t code = 0, http_code = 0, streamed = 0;
+			if (not reader.integer(item.start, 8)) break;
+			if (not reader.integer(item.duration, 8)
+				|| not reader.integer(item.sent, 8)
+				|| not reader.integer(item.received, 8)
+				|| not reader.integer(code, 4)
+				|| not reader.integer(http_code, 4)
+				|| not reader.integer(streamed, 1)
+				|| not reader.text(item.method)
+				|| not reader.text(item.url)
+				|| not reader.text(item.headers)
+				|| not reader.text(item.body)
+				|| not reader.text(item.response)) {
+				throw std::runtime_error("truncated transcript");
+			}
+			item.code = static_cast<std::int32_t>(code);
+			item.http_code = static_cast<std::int32_t>(http_code);
+			item.streamed = streamed != 0;
+			m_exchanges[key(item.method, item.url)].exchanges.push_back(std::move(item));
+		}
+	}
+
+	auto player::find(request& request) -> const exchange * {
+		std::lock_guard<std::mutex> lock{m_mutex};
+		auto found = m_exchanges.find(key(request.method(), request.url()));
+		if (found == m_exchanges.end()) return nullptr;
+
+		auto& recorded = found->second;
+		auto index = std::min(recorded.next, recorded.exchanges.size() - 1);
+		recorded.next = index + 1;
+		return &recorded.exchanges[index];
+	}
+
+	auto player::delay(const exchange * recorded) const -> std::chrono::microseconds {
+		if (recorded == nullptr) return std::chrono::microseconds::zero();
+		return std::chrono::microseconds{static_cast<std::int64_t>(recorded->duration * m_time_scale)};
+	}
+
+	auto player::serve(request& request, const exchange * recorded) -> CURLcode {
+		// a recorded upload consumed its source, so does the replay
+		std::vector<char> buffer(64 << 10);
+		while (request.source() != nullptr) {
+			auto count = request.source()->read(buffer.data(), buffer.size());
+			if (count == 0 || count == source::abort) break;
+		}
+
+		if (recorded == nullptr) {
+			return CURLE_COULDNT_CONNECT;
+		}
+		if (recorded->code != CURLE_OK) {
+			return static_cast<CURLcode>(recorded->code);
+		}
+		request.set_answered(recorded->http_code, static_cast<std::int64_t>(recorded->received));
+
+		if (not recorded->streamed) {
+			request.response().write(recorded->response.data(), recorded->response.size());
+			return CURLE_OK;
+		}
+		// streamed content is not kept, the sink gets as many filler bytes
+		request.sink()->reserve(recorded->received);
+		std::fill(buffer.begin(), buffer.end(), 0);
+		for (auto left = recorded->received; left > 0;) {
+			auto count = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+			if (not request.sink()->write(buffer.data(), count)) return CURLE_WRITE_ERROR;
+			left -= count;
+		}
+		return CURLE_OK;
+	}
+}
+}
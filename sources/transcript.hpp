@@ -0,0 +1,126 @@
+#ifndef __TRANSCRIPT_HPP__
+#define __TRANSCRIPT_HPP__
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+#include "request.hpp"
+
+namespace yadisk
+{
+namespace detail
+{
+    ///
+    /// \brief one recorded http exchange. Bodies streamed to a sink or from
+    ///     a source are not kept, only their sizes.
+    ///
+    struct exchange
+    {
+        std::string method;
+        std::string url;
+        std::string headers;
+        std::string body;
+        std::int32_t code;
+        std::int32_t http_code;
+        /// microseconds from the start of recording to the start of the request
+        std::uint64_t start;
+        std::uint64_t duration;
+        std::uint64_t sent;
+        std::uint64_t received;
+        bool streamed;
+        std::string response;
+    };
+
+    ///
+    /// \brief appends exchanges to a transcript file. The file starts with
+    ///     "YDTR" and a version, then records of little endian integers
+    ///     and length prefixed strings. Authorization headers are redacted.
+    ///
+    class recorder
+    {
+    public:
+
+        explicit recorder(const fs::path& path);
+
+        recorder(const recorder&) = delete;
+
+        auto operator=(const recorder&) -> recorder& = delete;
+
+        ~recorder();
+
+        ///
+        /// \brief microseconds since the recording started.
+        ///
+        auto elapsed() const -> std::uint64_t;
+
+        ///
+        /// \brief records request performed with result code, started at
+        ///     elapsed() time start and lasted duration microseconds.
+        ///
+        auto record(request& request, CURLcode code, std::uint64_t start, std::uint64_t duration) -> void;
+
+    private:
+
+        std::mutex m_mutex;
+        std::FILE * m_file;
+        std::chrono::steady_clock::time_point m_started;
+    };
+
+    ///
+    /// \brief serves responses of a transcript instead of the network.
+    ///     Requests are matched by method and url; identical requests get
+    ///     the recorded responses in order, the last one repeats.
+    ///
+    class player
+    {
+    public:
+
+        ///
+        /// \param time_scale multiplies recorded durations, 0 serves at once
+        ///
+        player(const fs::path& path, double time_scale);
+
+        ///
+        /// \brief next recorded exchange for request, nullptr if there is
+        ///     none.
+        ///
+        auto find(request& request) -> const exchange *;
+
+        ///
+        /// \brief time request has to take to reproduce the recording.
+        ///
+        auto delay(const exchange * recorded) const -> std::chrono::microseconds;
+
+        ///
+        /// \brief hands the recorded response over to request, as curl
+        ///     would: into its sink or its response. The source of the
+        ///     request is drained.
+        ///
+        auto serve(request& request, const exchange * recorded) -> CURLcode;
+
+    private:
+
+        struct queue
+        {
+            std::deque<exchange> exchanges;
+            std::size_t next = 0;
+        };
+
+        double m_time_scale;
+        std::mutex m_mutex;
+        std::map<std::string, queue> m_exchanges;
+    };
+}
+}
+
+#endif // __TRANSCRIPT_HPP__
@@ -3,17 +3,58 @@
 
 #include <curl/curl.h>
 
+#include <stdexcept>
+#include <vector>
+
+// Easy handles kept per thread, so a Client shared between threads never
+// contends on them. A released handle is reset but keeps its buffers.
+class CurlHandleCache
+{
+public:
+	static CurlHandleCache& local() {
+		thread_local CurlHandleCache cache;
+		return cache;
+	}
+	CURL * acquire() {
+		if (handles.empty()) {
+			return curl_easy_init();
+		}
+		auto curl = handles.back();
+		handles.pop_back();
+		return curl;
+	}
+	void release(CURL * curl) {
+		curl_easy_setopt(curl, CURLOPT_SHARE, nullptr);
+		curl_easy_reset(curl);
+		if (handles.size() < capacity) {
+			handles.push_back(curl);
+		}
+		else {
+			curl_easy_cleanup(curl);
+		}
+	}
+	~CurlHandleCache() {
+		for (auto curl : handles) {
+			curl_easy_cleanup(curl);
+		}
+	}
+
+private:
+	static const std::size_t capacity = 4;
+	std::vector<CURL *> handles;
+};
+
 class CurlWrapper
 {
 public:
 	CurlWrapper() {
-		curl = curl_easy_init();
+		curl = CurlHandleCache::local().acquire();
 		if (curl == nullptr) {
 			throw std::runtime_error("curl_easy_init");
 		}
 	}
 	virtual ~CurlWrapper() {
-		curl_easy_cleanup(curl);
+		CurlHandleCache::local().release(curl);
 	}
 	CURL * getCurl() {
 		return curl;
@@ -26,11 +67,18 @@ private:
 class CurlSlistWrapper
 {
 public:
+	CurlSlistWrapper()
+		: header_list(nullptr)
+	{
+	}
 	explicit CurlSlistWrapper(const char* s)
 		: header_list(nullptr)
 	{
 		header_list = curl_slist_append(header_list, s);
 	}
+	void append(const char* s) {
+		header_list = curl_slist_append(header_list, s);
+	}
 	virtual ~CurlSlistWrapper() {
 		curl_slist_free_all(header_list);
 	}
@@ -0,0 +1,33 @@
+#include <catch.hpp>
+#include <yadisk/async_client.hpp>
+using ydclient = yadisk::Client;
+
+#include <string>
+
+#include <url/path.hpp>
+
+TEST_CASE("async ping with valid token", "[client][async][ping]") {
+    boost::asio::io_context io;
+    yadisk::AsyncClient client{ io, ydclient{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" } };
+    bool pinged = false;
+    client.async_ping([&pinged](boost::system::error_code ec, bool ok) {
+        pinged = not ec && ok;
+    });
+    io.run();
+    REQUIRE(pinged);
+}
+
+TEST_CASE("async info of several resources on one io_context", "[client][async][info]") {
+    boost::asio::io_context io;
+    yadisk::AsyncClient client{ io, ydclient{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" } };
+    json file, directory;
+    client.async_info(url::path{ "/file.dat" }, nullptr, [&file](boost::system::error_code ec, json meta) {
+        if (not ec) file = meta;
+    });
+    client.async_info(url::path{ "/empty_directory" }, nullptr, [&directory](boost::system::error_code ec, json meta) {
+        if (not ec) directory = meta;
+    });
+    io.run();
+    REQUIRE(file["type"].get<std::string>() == "file");
+    REQUIRE(directory["type"].get<std::string>() == "dir");
+}
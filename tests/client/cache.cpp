@@ -0,0 +1,41 @@
+#include <catch.hpp>
+#include <yadisk/blob_cache.hpp>
+
+#include <fstream>
+
+static const std::string sha256 = "b1cf7530e0c1a5bcc1d5a4b0b1cf7530e0c1a5bcc1d5a4b0b1cf7530e0c1a5bc";
+
+TEST_CASE("blob cache evicts least recently used files", "[cache]") {
+    auto directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory / "b1");
+    fs::create_directories(directory / "aa");
+    std::ofstream{ (directory / "b1" / sha256).string() } << std::string(100, 'x');
+    std::ofstream{ (directory / "aa" / "older").string() } << std::string(100, 'y');
+    fs::last_write_time(directory / "aa" / "older", std::time(nullptr) - 3600);
+
+    yadisk::BlobCache cache{ directory, 150 };
+    REQUIRE(cache.size() == 200);
+    REQUIRE(cache.find("not a hash").empty());
+    REQUIRE(cache.find(sha256) == directory / "b1" / sha256);
+
+    cache.evict();
+    REQUIRE(cache.size() == 100);
+    REQUIRE(not cache.find(sha256).empty());
+    fs::remove_all(directory);
+}
+
+TEST_CASE("second download is served by the blob cache", "[client][cache]") {
+    yadisk::Client client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    auto directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    yadisk::BlobCache cache{ directory / "cache", 1 << 20 };
+
+    auto first = cache.download(client, url::path{ "/file.dat" }, directory / "first.dat");
+    REQUIRE(first["name"].get<std::string>() == "file.dat");
+    auto requests = client.stats().requests;
+    auto second = cache.download(client, url::path{ "/file.dat" }, directory / "second.dat");
+    REQUIRE(second["name"].get<std::string>() == "file.dat");
+    REQUIRE(client.stats().requests == requests + 1);
+    REQUIRE(fs::file_size(directory / "second.dat") == fs::file_size(directory / "first.dat"));
+    fs::remove_all(directory);
+}
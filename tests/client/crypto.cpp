@@ -0,0 +1,86 @@
+#include <catch.hpp>
+#include <yadisk/crypto.hpp>
+
+#include <sstream>
+#include <string>
+
+static const std::string key(32, 'k');
+
+static std::string encrypt(const std::string& content, std::size_t chunk_size) {
+    std::stringstream in{ content };
+    yadisk::stream_source upstream{ in };
+    yadisk::encrypting_source source{ upstream, key, chunk_size, 3 };
+    std::string out;
+    char buffer[1000];
+    std::size_t count = 0;
+    while ((count = source.read(buffer, sizeof(buffer))) > 0) {
+        REQUIRE(count != yadisk::source::abort);
+        out.append(buffer, count);
+    }
+    return out;
+}
+
+static bool decrypt(const std::string& encrypted, std::string& plaintext) {
+    std::stringstream out;
+    yadisk::stream_sink downstream{ out };
+    yadisk::decrypting_sink sink{ downstream, key, 3 };
+    for (std::size_t offset = 0; offset < encrypted.size(); offset += 777) {
+        auto piece = encrypted.substr(offset, 777);
+        if (not sink.write(piece.data(), piece.size())) break;
+    }
+    sink.close();
+    plaintext = out.str();
+    return not sink.failed();
+}
+
+TEST_CASE("encrypted content decrypts to the original", "[crypto]") {
+    std::string content;
+    for (int i = 0; i < 100000; ++i) content.push_back(static_cast<char>(i * 13));
+
+    for (std::size_t size : { 0, 1, 4096, 4097, 100000 }) {
+        auto encrypted = encrypt(content.substr(0, size), 4096);
+        yadisk::encrypted_layout layout;
+        REQUIRE(yadisk::encrypted_layout::parse(encrypted.data(), layout));
+        REQUIRE(layout.plaintext_size(encrypted.size()) == size);
+        std::string plaintext;
+        REQUIRE(decrypt(encrypted, plaintext));
+        REQUIRE(plaintext == content.substr(0, size));
+    }
+}
+
+TEST_CASE("encrypted content is authenticated", "[crypto]") {
+    std::string content(10000, 'x');
+    auto encrypted = encrypt(content, 4096);
+
+    std::string plaintext;
+    auto tampered = encrypted;
+    tampered[5000] ^= 1;
+    REQUIRE_FALSE(decrypt(tampered, plaintext));
+
+    auto truncated = encrypted.substr(0, yadisk::encrypted_layout::header_size + 4096 + 16);
+    REQUIRE_FALSE(decrypt(truncated, plaintext));
+
+    REQUIRE_FALSE(decrypt(content, plaintext));
+}
+
+TEST_CASE("one frame of encrypted content decrypts on its own", "[crypto]") {
+    std::string content;
+    for (int i = 0; i < 10000; ++i) content.push_back(static_cast<char>(i));
+    auto encrypted = encrypt(content, 4096);
+
+    yadisk::encrypted_layout layout;
+    REQUIRE(yadisk::encrypted_layout::parse(encrypted.data(), layout));
+    REQUIRE(layout.frames(encrypted.size()) == 3);
+    auto frame = encrypted.substr(layout.frame_offset(1), layout.frame_size());
+    REQUIRE(layout.decrypt(key, 1, false, frame));
+    REQUIRE(frame == content.substr(4096, 4096));
+}
+
+TEST_CASE("encrypting source does not read before the transfer", "[crypto]") {
+    std::stringstream in{ std::string(10000, 'x') };
+    yadisk::stream_source upstream{ in };
+    {
+        yadisk::encrypting_source source{ upstream, key, 4096, 3 };
+    }
+    REQUIRE(in.tellg() == 0);
+}
@@ -0,0 +1,53 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <chrono>
+#include <thread>
+
+#include <curl/curl.h>
+
+#include <url/path.hpp>
+using url::path;
+
+TEST_CASE("call past its deadline fails without a request", "[client][deadline]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    ydclient late = client;
+    late.set_deadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    auto info = late.try_info(path{ "/file.dat" });
+    REQUIRE_FALSE(info);
+    REQUIRE(info.error().code == yadisk::errc::transport);
+    REQUIRE(info.error().transport == CURLE_OPERATION_TIMEDOUT);
+    REQUIRE(late.stats().requests == 0);
+}
+
+TEST_CASE("cancelled client fails every call", "[client][deadline]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    yadisk::cancellation token;
+    client.set_cancellation(token);
+    token.cancel();
+    auto info = client.try_info(path{ "/file.dat" });
+    REQUIRE_FALSE(info);
+    REQUIRE(info.error().transport == CURLE_ABORTED_BY_CALLBACK);
+    REQUIRE_FALSE(client.list(json{ { "limit", 10 } }, [](const json&) { return true; }));
+    REQUIRE_FALSE(client.ping());
+}
+
+TEST_CASE("cancel a call in flight", "[client][deadline][download]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    yadisk::cancellation token;
+    client.set_cancellation(token);
+    std::thread canceller{ [token]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        token.cancel();
+    } };
+    auto started = std::chrono::steady_clock::now();
+    yadisk::callback_sink sink{ [](const char *, std::size_t) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return true;
+    } };
+    auto download = client.try_download(path{ "/file.dat" }, sink);
+    canceller.join();
+    REQUIRE_FALSE(download);
+    REQUIRE(std::chrono::steady_clock::now() - started < std::chrono::seconds(5));
+}
@@ -0,0 +1,142 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <url/path.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+// counts every allocation of the test binary, so the benchmark below sees
+// the nodes of json as well as the strings inside them
+static std::atomic<std::size_t> allocations{0};
+
+void * operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto data = std::malloc(size == 0 ? 1 : size)) return data;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * data) noexcept {
+    std::free(data);
+}
+
+static ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+
+// a page of /resources/files as the api returns it
+static std::string listing(std::size_t count) {
+    auto items = json::array();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto name = "photo_" + std::to_string(i) + ".jpg";
+        json item;
+        item["name"] = name;
+        item["path"] = "disk:/photos/2017/" + name;
+        item["type"] = "file";
+        item["mime_type"] = "image/jpeg";
+        item["media_type"] = "image";
+        item["size"] = 1000 + i;
+        item["created"] = "2017-03-01T12:00:00+00:00";
+        item["modified"] = "2017-03-01T12:00:00+00:00";
+        item["md5"] = "4b7d0ea3bd5b8e1b3c5b0f1d6a8e3f2" + std::to_string(i % 10);
+        item["sha256"] = "a3f1c2d4e5b6978812345678901234567890abcdefabcdefabcdefabcdef012" + std::to_string(i % 10);
+        item["resource_id"] = "4000000000:" + std::to_string(i);
+        items.push_back(item);
+    }
+    json page;
+    page["items"] = items;
+    page["limit"] = count;
+    page["offset"] = 0;
+    return page.dump();
+}
+
+TEST_CASE ("document has the values of json", "[client][document]")
+{
+    auto text = listing (100);
+    auto document = yadisk::document::parse (text);
+    REQUIRE (json::parse (document.root().dump().c_str()) == json::parse (text));
+    auto& item = document.root()["items"][42];
+    REQUIRE (item["name"].get_ref<const yadisk::arena_string&>() == "photo_42.jpg");
+    REQUIRE (item["size"].get<std::uint64_t>() == 1042);
+}
+
+TEST_CASE ("copy of a value outlives its document", "[client][document]")
+{
+    yadisk::arena_json item;
+    {
+        auto document = yadisk::document::parse (listing (10));
+        item = document.root()["items"][3];
+        document.root()["items"].push_back (item);
+        REQUIRE (document.root()["items"].size() == 11);
+    }
+    REQUIRE (item["path"].get_ref<const yadisk::arena_string&>() == "disk:/photos/2017/photo_3.jpg");
+}
+
+TEST_CASE ("moved document keeps its values", "[client][document]")
+{
+    yadisk::document moved;
+    REQUIRE (moved.root().is_null());
+    REQUIRE (moved.allocations() == 0);
+    moved = yadisk::document::parse (listing (10));
+    yadisk::document document{ std::move (moved) };
+    REQUIRE (document.root()["items"].size() == 10);
+    REQUIRE (moved.root().is_null());
+}
+
+TEST_CASE ("malformed text is not a document", "[client][document]")
+{
+    REQUIRE_THROWS (yadisk::document::parse ("{\"items\": ["));
+}
+
+TEST_CASE ("allocations of a parsed listing", "[client][document][benchmark]")
+{
+    auto text = listing (1000);
+    const int rounds = 20;
+    using clock = std::chrono::steady_clock;
+
+    auto before = allocations.load();
+    auto started = clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        auto parsed = json::parse (text);
+        REQUIRE (parsed["items"].size() == 1000);
+    }
+    auto plain_time = clock::now() - started;
+    auto plain = (allocations.load() - before) / rounds;
+
+    before = allocations.load();
+    started = clock::now();
+    std::size_t blocks = 0;
+    for (int i = 0; i < rounds; ++i) {
+        auto parsed = yadisk::document::parse (text);
+        REQUIRE (parsed.root()["items"].size() == 1000);
+        blocks = parsed.allocations();
+    }
+    auto arena_time = clock::now() - started;
+    auto arena = (allocations.load() - before) / rounds;
+
+    INFO ("json: " << plain << " allocations, "
+          << std::chrono::duration_cast<std::chrono::microseconds>(plain_time).count() / rounds << " us per parse");
+    INFO ("document: " << arena << " allocations in " << blocks << " blocks, "
+          << std::chrono::duration_cast<std::chrono::microseconds>(arena_time).count() / rounds << " us per parse");
+    CHECK (arena * 100 < plain);
+    CHECK (blocks <= 4);
+}
+
+TEST_CASE ("try_list_document with valid token", "[client][document]")
+{
+    json options;
+    options["limit"] = 10;
+    auto document = client.try_list_document (options);
+    REQUIRE (static_cast<bool>(document));
+    REQUIRE (json::parse (document.value().root().dump().c_str()) == client.list (options));
+}
+
+TEST_CASE ("try_info_document with valid token and invalid file", "[client][document]")
+{
+    auto document = client.try_info_document (url::path{ "/invalid_file.dat" });
+    REQUIRE (not document);
+    REQUIRE (document.error().http_code == 404);
+    REQUIRE (document.error().name == "DiskNotFoundError");
+}
@@ -0,0 +1,45 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <url/path.hpp>
+using url::path;
+
+TEST_CASE("buffer sink refuses data beyond its capacity", "[sink]") {
+    std::vector<char> buffer(4);
+    yadisk::buffer_sink sink{ buffer.data(), buffer.size() };
+    REQUIRE(sink.write("abc", 3));
+    REQUIRE_FALSE(sink.write("de", 2));
+    REQUIRE(sink.size() == 3);
+}
+
+#ifdef __linux__
+TEST_CASE("file sink reports a failed flush on close", "[sink]") {
+    // /dev/full takes writes into the buffer and fails them when flushed
+    yadisk::file_sink sink{ "/dev/full" };
+    REQUIRE(sink.write("abc", 3));
+    REQUIRE_FALSE(sink.close());
+}
+#endif
+
+TEST_CASE("download file into stream sink", "[client][download]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    std::stringstream content;
+    yadisk::stream_sink sink{ content };
+    auto link = client.download(path{ "/file.dat" }, sink);
+    REQUIRE(link.find("href") != link.end());
+    REQUIRE(not content.str().empty());
+}
+
+TEST_CASE("download missing file", "[client][download]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    std::stringstream content;
+    yadisk::stream_sink sink{ content };
+    auto link = client.download(path{ "/invalid_file.dat" }, sink);
+    REQUIRE(link["error"].get<std::string>() == "DiskNotFoundError");
+    REQUIRE(content.str().empty());
+}
@@ -0,0 +1,35 @@
+#include <catch.hpp>
+#include <yadisk/index.hpp>
+using ydclient = yadisk::Client;
+
+#include <string>
+
+TEST_CASE("index without file is empty", "[index]") {
+    auto file = fs::temp_directory_path() / fs::unique_path();
+    yadisk::Index index{ file };
+    REQUIRE(index.size() == 0);
+    REQUIRE(index.refreshed() == 0);
+    REQUIRE_FALSE(static_cast<bool>(index.find("/file.dat")));
+    REQUIRE(index.folder_size("/") == 0);
+    REQUIRE(index.list("/").empty());
+}
+
+TEST_CASE("index of whole disk", "[client][index]") {
+    auto file = fs::temp_directory_path() / fs::unique_path();
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    {
+        yadisk::Index index{ file };
+        REQUIRE(index.build(client));
+        REQUIRE(index.refreshed() != 0);
+    }
+    yadisk::Index index{ file };
+    auto meta = index.find("/file.dat");
+    REQUIRE(static_cast<bool>(meta));
+    REQUIRE(not meta->directory);
+    REQUIRE(static_cast<bool>(index.find("disk:/empty_directory")));
+    REQUIRE(index.list("/empty_directory").empty());
+    REQUIRE(index.find_name("file.dat").size() >= 1);
+    REQUIRE(index.refresh(client));
+    REQUIRE(static_cast<bool>(index.find("/file.dat")));
+    fs::remove(file);
+}
@@ -4,6 +4,9 @@ using ydclient = yadisk::Client;
 
 #include <url/path.hpp>
 
+#include <thread>
+#include <vector>
+
 static ydclient invalid_client{ "JS1w4zmPUdrsJNR1FATxEM" };
 static ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
 
@@ -346,3 +349,65 @@ TEST_CASE ("info with invalid option preview_crop", "[client][info]")
     REQUIRE (meta.find ("preview") != meta.end());
     REQUIRE (get_preview_crop (meta["preview"].get<std::string>()) == "0");
 }
+
+TEST_CASE ("info for the same file from many threads", "[client][info]")
+{
+    ydclient shared{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    url::path resource{ "/file.dat" };
+    std::vector<json> metas(8);
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < metas.size(); ++i) {
+        workers.emplace_back([&shared, &resource, &metas, i]() {
+            metas[i] = shared.info (resource);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (auto& meta : metas) {
+        REQUIRE (meta["name"].get<std::string>() == "file.dat");
+    }
+    auto stats = shared.stats();
+    REQUIRE (stats.requests + stats.coalesced == metas.size());
+}
+
+TEST_CASE ("try_info with valid token and invalid file", "[client][info]")
+{
+    url::path resource{ "/invalid_file.dat" };
+    auto meta = client.try_info (resource);
+    REQUIRE (not meta);
+    REQUIRE (meta.error().code == yadisk::errc::api);
+    REQUIRE (meta.error().http_code == 404);
+    REQUIRE (meta.error().name == "DiskNotFoundError");
+}
+
+TEST_CASE ("try_info with valid token and valid file", "[client][info]")
+{
+    url::path resource{ "/file.dat" };
+    auto meta = client.try_info (resource);
+    REQUIRE (static_cast<bool>(meta));
+    REQUIRE (meta.value()["name"].get<std::string>() == "file.dat");
+}
+
+TEST_CASE ("info with prepared options", "[client][info]")
+{
+    json options;
+    options["limit"] = 5;
+    auto prepared = client.prepare_info (options);
+    for (auto resource : { "/", "/empty_directory" }) {
+        auto meta = client.info (prepared, url::path{ resource });
+        REQUIRE (meta == client.info (url::path{ resource }, options));
+    }
+}
+
+TEST_CASE ("info with hedging", "[client][info]")
+{
+    ydclient hedged{ client };
+    hedged.set_hedging (0.9, 0.1);
+    url::path resource{ "/file.dat" };
+    auto expected = client.info (resource);
+    const std::size_t calls = 50;
+    for (std::size_t i = 0; i < calls; ++i) {
+        REQUIRE (hedged.info (resource) == expected);
+    }
+    // every call earns a tenth of a hedge, the first ones are not hedged
+    REQUIRE (hedged.stats().hedged <= calls / 10 + 1);
+}
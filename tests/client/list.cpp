@@ -0,0 +1,37 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <string>
+#include <vector>
+
+static ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+
+TEST_CASE("list one page of files", "[client][list]")
+{
+    json options;
+    options["limit"] = 2;
+    auto page = client.list(options);
+    REQUIRE(not page.empty());
+    REQUIRE(page.find("error") == page.end());
+    REQUIRE(page["items"].size() <= 2);
+}
+
+TEST_CASE("list all files with small pages in parallel", "[client][list]")
+{
+    json options;
+    options["limit"] = 1;
+    std::vector<std::string> paths;
+    auto complete = client.list(options, [&paths](const json& item) {
+        paths.push_back(item["path"].get<std::string>());
+        return true;
+    }, 4);
+    REQUIRE(complete);
+
+    options["limit"] = 1000;
+    auto page = client.list(options);
+    REQUIRE(page["items"].size() == paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        REQUIRE(page["items"][i]["path"].get<std::string>() == paths[i]);
+    }
+}
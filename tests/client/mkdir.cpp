@@ -0,0 +1,58 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <url/path.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+static ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+
+TEST_CASE ("mkdir with valid token and existing directory", "[client][mkdir]")
+{
+    auto answer = client.try_mkdir (url::path{ "/empty_directory" });
+    REQUIRE (not answer);
+    REQUIRE (answer.error().http_code == 409);
+    REQUIRE (answer.error().name == "DiskPathPointsToExistentDirectoryError");
+}
+
+TEST_CASE ("mkdir with valid token and missing parent", "[client][mkdir]")
+{
+    auto answer = client.mkdir (url::path{ "/missing_directory/child" });
+    REQUIRE (answer["error"] == "DiskPathDoesntExistsError");
+}
+
+TEST_CASE ("mkdir of a tree creates shared parents once", "[client][mkdir]")
+{
+    auto stamp = std::chrono::system_clock::now().time_since_epoch().count();
+    auto root = "/mkdir_" + std::to_string(stamp);
+    std::vector<url::path> dirs;
+    for (auto a : { "a", "b" }) {
+        for (auto b : { "1", "2", "3" }) {
+            dirs.push_back (url::path{ root + "/" + a + "/" + b });
+        }
+    }
+
+    auto report = client.mkdir (dirs);
+    REQUIRE (report["created"] == 1 + 2 + 6);
+    REQUIRE (report["failed"].empty());
+    auto info = client.info (url::path{ root + "/b/3" });
+    REQUIRE (info["type"] == "dir");
+
+    // everything is known now, nothing is asked again
+    auto requests = client.stats().requests;
+    report = client.mkdir (dirs);
+    REQUIRE (report["created"] == 0);
+    REQUIRE (report["existed"] == 0);
+    REQUIRE (report["known"] == dirs.size());
+    REQUIRE (client.stats().requests == requests);
+
+    // a removed directory is made again
+    client.remove (url::path{ root + "/a" }, true);
+    report = client.mkdir (dirs);
+    REQUIRE (report["created"] == 1 + 3);
+    REQUIRE (report["known"] == 3);
+    client.remove (url::path{ root }, true);
+}
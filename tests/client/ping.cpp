@@ -4,6 +4,7 @@ using ydclient = yadisk::Client;
 
 #include <string>
 #include <list>
+#include <thread>
 
 #include <url/path.hpp>
 using url::path;
@@ -19,3 +20,21 @@ TEST_CASE("ping with invalid token", "[client][ping]") {
     ydclient client{ token };
     REQUIRE_FALSE(client.ping());
 }
+
+TEST_CASE("warmup before the first request", "[client][ping][warmup]") {
+    REQUIRE(yadisk::initialize());
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    REQUIRE(client.warmup(2).get() == 2);
+    REQUIRE(client.ping());
+}
+
+TEST_CASE("keep alive reports health", "[client][ping][warmup]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    REQUIRE_FALSE(client.healthy());
+    client.keep_alive(std::chrono::seconds(60));
+    for (int i = 0; i < 100 && not client.healthy(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    REQUIRE(client.healthy());
+    client.keep_alive(std::chrono::seconds(0));
+}
@@ -0,0 +1,33 @@
+#include <catch.hpp>
+#include <yadisk/client_pool.hpp>
+using ydclient = yadisk::Client;
+
+#include <thread>
+#include <vector>
+
+TEST_CASE("pool keeps a client per account", "[client][pool]") {
+    yadisk::ClientPool pool{ 4 };
+    auto first = pool.client("first", "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+    auto second = pool.client("second", "JS1w4zmPUdrsJNR1FATxEM");
+    REQUIRE(first.token() == "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+    REQUIRE(second.token() == "JS1w4zmPUdrsJNR1FATxEM");
+    pool.set_limits("third", { 2, 10 });
+    REQUIRE(pool.size() == 3);
+    pool.remove("third");
+    REQUIRE(pool.size() == 2);
+}
+
+TEST_CASE("accounts share one slot", "[client][pool][ping]") {
+    yadisk::ClientPool pool{ 1 };
+    std::vector<std::thread> workers;
+    std::vector<int> results(6, 0);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        auto client = pool.client(i % 2 == 0 ? "busy" : "idle", "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+        workers.emplace_back([client, &results, i]() mutable {
+            results[i] = client.ping() ? 1 : 0;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (auto result : results) REQUIRE(result == 1);
+    REQUIRE(pool.stats().requests == results.size());
+}
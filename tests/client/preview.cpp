@@ -0,0 +1,36 @@
+#include <catch.hpp>
+#include <yadisk/preview_cache.hpp>
+
+static json file_item(const std::string& md5) {
+    json item;
+    item["md5"] = md5;
+    item["preview"] = "https://downloader.disk.yandex.ru/preview/1";
+    return item;
+}
+
+TEST_CASE("previews are addressed by content, size and crop", "[preview]") {
+    yadisk::PreviewCache cache{ "cache" };
+    auto md5 = std::string{ "0123456789abcdef0123456789abcdef" };
+    REQUIRE(cache.path(file_item(md5), "M") == fs::path{ "cache/01/0123456789abcdef0123456789abcdef_M" });
+    REQUIRE(cache.path(file_item(md5), "120x80", true) == fs::path{ "cache/01/0123456789abcdef0123456789abcdef_120x80_crop" });
+    REQUIRE(cache.path(file_item("../../etc/passwd"), "M").empty());
+    REQUIRE(cache.path(json{ { "md5", md5 } }, "M").empty());
+}
+
+TEST_CASE("fetch previews of the disk root", "[client][preview]") {
+    yadisk::Client client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    json options;
+    options["preview_size"] = "S";
+    auto files = client.list(options);
+    REQUIRE(files.find("items") != files.end());
+
+    std::vector<json> items(files["items"].begin(), files["items"].end());
+    auto directory = fs::temp_directory_path() / fs::unique_path();
+    yadisk::PreviewCache cache{ directory };
+    auto paths = cache.fetch(client, items, "S");
+    REQUIRE(paths.size() == items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        if (not paths[i].empty()) REQUIRE(fs::exists(paths[i]));
+    }
+    fs::remove_all(directory);
+}
@@ -0,0 +1,28 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <thread>
+#include <vector>
+
+TEST_CASE("copies keep their own priority", "[client][priority]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    ydclient backup = client;
+    backup.set_priority(yadisk::priority::background);
+    REQUIRE(client.get_priority() == yadisk::priority::interactive);
+    REQUIRE(backup.get_priority() == yadisk::priority::background);
+}
+
+TEST_CASE("ping within a connection budget of one", "[client][priority][ping]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    client.set_limits(yadisk::priority::interactive, { 1, 0, 0 });
+    std::vector<std::thread> workers;
+    std::vector<int> results(4, 0);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        workers.emplace_back([&client, &results, i]() {
+            results[i] = client.ping() ? 1 : 0;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (auto result : results) REQUIRE(result == 1);
+}
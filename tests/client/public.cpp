@@ -0,0 +1,24 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <string>
+
+#include <url/path.hpp>
+
+static ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+
+TEST_CASE("info of invalid public key", "[client][public][info]")
+{
+    auto meta = client.info(std::string{ "invalid_public_key" });
+    REQUIRE(not meta.empty());
+    REQUIRE(meta["error"].get<std::string>() == "DiskNotFoundError");
+}
+
+TEST_CASE("download folder of invalid public key", "[client][public][download]")
+{
+    auto report = client.download_folder(std::string{ "invalid_public_key" }, fs::temp_directory_path() / "public");
+    REQUIRE(not report.empty());
+    REQUIRE(report["downloaded"].get<int>() == 0);
+    REQUIRE(report["failed"].size() == 1);
+}
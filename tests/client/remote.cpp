@@ -0,0 +1,104 @@
+#include <catch.hpp>
+#include <yadisk/remote_file.hpp>
+using ydclient = yadisk::Client;
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <url/path.hpp>
+using url::path;
+
+TEST_CASE("ranges of a remote file match the download", "[client][download][remote]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    std::stringstream content;
+    yadisk::stream_sink sink{ content };
+    client.download(path{ "/file.dat" }, sink);
+    auto whole = content.str();
+    REQUIRE(not whole.empty());
+
+    yadisk::RemoteFile file{ client, path{ "/file.dat" }, 1024, 4 };
+    auto size = file.size();
+    REQUIRE(static_cast<bool>(size));
+    REQUIRE(size.value() == whole.size());
+
+    // the tail comes with the size
+    std::vector<char> buffer(std::min<std::size_t>(whole.size(), 100));
+    auto read = file.pread(buffer.data(), buffer.size(), whole.size() - buffer.size());
+    REQUIRE(static_cast<bool>(read));
+    REQUIRE(std::string(buffer.data(), read.value()) == whole.substr(whole.size() - buffer.size()));
+    REQUIRE(file.requests() == 1);
+
+    std::string sequential;
+    char chunk[300];
+    for (;;) {
+        auto count = file.pread(chunk, sizeof(chunk), sequential.size());
+        REQUIRE(static_cast<bool>(count));
+        if (count.value() == 0) break;
+        sequential.append(chunk, count.value());
+    }
+    REQUIRE(sequential == whole);
+}
+
+TEST_CASE("remote file which does not exist", "[client][download][remote]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    yadisk::RemoteFile file{ client, path{ "/invalid_file.dat" } };
+    char chunk[10];
+    auto read = file.pread(chunk, sizeof(chunk), 0);
+    REQUIRE_FALSE(read);
+    REQUIRE(read.error().code == yadisk::errc::api);
+}
+
+TEST_CASE("remote file from a server which ignores ranges", "[client][download][remote][transcript]") {
+    // a transcript in which the storage answers every range with the whole
+    // file of 3000 bytes
+    auto put = [](std::string& out, std::uint64_t value, std::size_t bytes) {
+        for (std::size_t i = 0; i < bytes; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+    };
+    auto exchange = [&put](std::string& out, const std::string& url, bool streamed, std::uint64_t received, const std::string& response) {
+        put(out, 0, 8);
+        put(out, 0, 8);
+        put(out, 0, 8);
+        put(out, received, 8);
+        put(out, 0, 4);
+        put(out, 200, 4);
+        put(out, streamed ? 1 : 0, 1);
+        for (auto text : { std::string{ "GET" }, url, std::string{}, std::string{}, response }) {
+            put(out, text.size(), 4);
+            out += text;
+        }
+    };
+    std::string content{ "YDTR" };
+    put(content, 1, 4);
+    auto link = std::string{ "{\"href\":\"https://downloader.disk.yandex.ru/file.dat\"}" };
+    exchange(content, "https://cloud-api.yandex.net/v1/disk/resources/download?path=/file.dat&", false, link.size(), link);
+    exchange(content, "https://downloader.disk.yandex.ru/file.dat", true, 3000, std::string{});
+    auto transcript = fs::temp_directory_path() / fs::unique_path();
+    std::ofstream{ transcript.string(), std::ios::binary } << content;
+
+    ydclient client{ "" };
+    REQUIRE(client.replay(transcript, 0));
+    yadisk::RemoteFile file{ client, path{ "/file.dat" }, 1024, 4 };
+
+    // the answer is cut off after the block, and the size is its length
+    auto size = file.size();
+    REQUIRE(static_cast<bool>(size));
+    REQUIRE(size.value() == 3000);
+
+    // the start of the file came instead of the tail
+    char chunk[100];
+    auto read = file.pread(chunk, sizeof(chunk), 0);
+    REQUIRE(static_cast<bool>(read));
+    REQUIRE(read.value() == sizeof(chunk));
+    REQUIRE(file.requests() == 1);
+
+    // other ranges can not be read
+    read = file.pread(chunk, sizeof(chunk), 2000);
+    REQUIRE_FALSE(read);
+    REQUIRE(read.error().code == yadisk::errc::api);
+    REQUIRE(read.error().http_code == 200);
+    fs::remove(transcript);
+}
@@ -0,0 +1,51 @@
+#include <catch.hpp>
+#include <yadisk/scanner.hpp>
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+
+TEST_CASE("scanner finds every file and directory below root", "[scanner]") {
+    auto directory = fs::temp_directory_path() / fs::unique_path();
+    std::map<std::string, std::uint64_t> expected;
+    for (auto a : { "a", "b", "c" }) {
+        for (auto b : { "1", "2" }) {
+            auto subdirectory = directory / a / b;
+            fs::create_directories(subdirectory);
+            expected[(directory / a).string()] = 0;
+            expected[subdirectory.string()] = 0;
+            for (auto i = 0; i < 10; ++i) {
+                auto file = subdirectory / ("file" + std::to_string(i));
+                std::ofstream{ file.string() } << std::string(i, 'x');
+                expected[file.string()] = i;
+            }
+        }
+    }
+
+    yadisk::Scanner scanner{ 4 };
+    std::map<std::string, std::uint64_t> found;
+    std::set<std::string> directories;
+    auto parents_first = true;
+    auto completed = scanner.scan(directory, [&](const yadisk::Scanner::entry_t& entry) {
+        found[entry.path.string()] = entry.size;
+        if (entry.directory) directories.insert(entry.path.string());
+        auto parent = entry.path.parent_path();
+        parents_first = parents_first && (parent == directory || directories.count(parent.string()) == 1);
+        return true;
+    });
+    REQUIRE(completed);
+    REQUIRE(found == expected);
+    REQUIRE(directories.size() == 9);
+    REQUIRE(parents_first);
+
+    std::size_t visited = 0;
+    completed = scanner.scan(directory, [&](const yadisk::Scanner::entry_t&) {
+        return ++visited < 5;
+    });
+    REQUIRE(not completed);
+    REQUIRE(visited == 5);
+
+    REQUIRE(not scanner.scan(directory / "missing", [](const yadisk::Scanner::entry_t&) { return true; }));
+    fs::remove_all(directory);
+}
@@ -0,0 +1,35 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("token rotation", "[client][token]") {
+    ydclient client{ "JS1w4zmPUdrsJNR1FATxEM" };
+    REQUIRE(client.token() == "JS1w4zmPUdrsJNR1FATxEM");
+    client.set_token("AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+    REQUIRE(client.token() == "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+}
+
+TEST_CASE("copies keep their own token", "[client][token]") {
+    ydclient client{ "JS1w4zmPUdrsJNR1FATxEM" };
+    ydclient copy = client;
+    copy.set_token("AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM");
+    REQUIRE(client.token() == "JS1w4zmPUdrsJNR1FATxEM");
+}
+
+TEST_CASE("ping from many threads with one client", "[client][token][ping]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    std::vector<std::thread> workers;
+    std::vector<int> results(4, 0);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        workers.emplace_back([&client, &results, i]() {
+            results[i] = client.ping() ? 1 : 0;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (auto result : results) REQUIRE(result == 1);
+    REQUIRE(client.stats().requests == results.size());
+}
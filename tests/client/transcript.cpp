@@ -0,0 +1,37 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+TEST_CASE("replay of a missing transcript", "[client][transcript]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    REQUIRE_FALSE(client.replay(fs::temp_directory_path() / fs::unique_path()));
+}
+
+TEST_CASE("replayed info matches the recorded one", "[client][transcript][info]") {
+    auto transcript = fs::temp_directory_path() / fs::unique_path();
+    url::path path{ "/file.dat" };
+
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    REQUIRE(client.record(transcript));
+    auto recorded = client.try_info(path);
+    client.stop_recording();
+
+    // the same result comes back whether the api answered or not, without a
+    // token and without the network
+    ydclient player{ "" };
+    REQUIRE(player.replay(transcript, 0));
+    auto replayed = player.try_info(path);
+    REQUIRE(static_cast<bool>(replayed) == static_cast<bool>(recorded));
+    if (recorded) {
+        REQUIRE(replayed.value() == recorded.value());
+    }
+    else {
+        REQUIRE(replayed.error().code == recorded.error().code);
+        REQUIRE(replayed.error().http_code == recorded.error().http_code);
+    }
+    REQUIRE(player.stats().requests == 1);
+
+    // a request which is not in the transcript does not reach the network
+    REQUIRE_FALSE(player.try_info(url::path{ "/other.dat" }));
+    fs::remove(transcript);
+}
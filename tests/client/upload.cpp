@@ -0,0 +1,62 @@
+#include <catch.hpp>
+#include <yadisk/client.hpp>
+using ydclient = yadisk::Client;
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <url/path.hpp>
+using url::path;
+
+TEST_CASE("buffered source passes content through a small ring", "[source]") {
+    std::string content;
+    for (int i = 0; i < 100000; ++i) content.push_back(static_cast<char>(i * 13));
+    std::stringstream in{ content };
+    yadisk::stream_source upstream{ in };
+    yadisk::buffered_source source{ upstream, 1000 };
+
+    std::string out;
+    char chunk[777];
+    std::size_t count = 0;
+    while ((count = source.read(chunk, sizeof(chunk))) != 0) {
+        REQUIRE(count != yadisk::source::abort);
+        out.append(chunk, count);
+    }
+    REQUIRE(out == content);
+}
+
+TEST_CASE("buffered source reports failure of producer", "[source]") {
+    yadisk::callback_source upstream{ [](char *, std::size_t) { return yadisk::source::abort; } };
+    yadisk::buffered_source source{ upstream, 1000 };
+    char chunk[10];
+    REQUIRE(source.read(chunk, sizeof(chunk)) == yadisk::source::abort);
+}
+
+TEST_CASE("upload from stream", "[client][upload]") {
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    std::stringstream in{ "generated on the fly" };
+    auto link = client.upload(path{ "/stream.txt" }, in, true);
+    REQUIRE(link.find("href") != link.end());
+}
+
+TEST_CASE("upload many small files", "[client][upload]") {
+    auto directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    std::vector<std::pair<fs::path, url::path>> files;
+    for (int i = 0; i < 10; ++i) {
+        auto name = "small" + std::to_string(i) + ".txt";
+        fs::ofstream{ directory / name } << "file " << i;
+        files.emplace_back(directory / name, path{ "/" + name });
+    }
+    files.emplace_back(directory / "missing.txt", path{ "/missing.txt" });
+
+    ydclient client{ "AQAAAAATPnx3AAQXOJS1w4zmPUdrsJNR1FATxEM" };
+    auto report = client.upload(files, true, 4, 4);
+    REQUIRE(report["uploaded"] == 10);
+    REQUIRE(report["failed"] == json::array({ "/missing.txt" }));
+    fs::remove_all(directory);
+}